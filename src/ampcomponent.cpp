@@ -7,6 +7,19 @@
 
 namespace nap
 {
+	/**
+	@brief Returns the amplitude to follow, the rms of the audio service or the rms / peak of an envelope band
+	**/
+	static float getAmplitude(lib::audio::AudioService& service, const EnvelopeComponent* envelope, int band, bool peak)
+	{
+		if (envelope == nullptr || (band == Envelope::Band::Full && !peak))
+			return service.rmsAmplitude.getValue();
+
+		const Envelope& current = envelope->getEnvelope();
+		return peak ? current.mPeak[band] : current.mRms[band];
+	}
+
+
 	/**
 	@brief Constructor
 	**/
@@ -30,7 +43,7 @@ namespace nap
 			return;
 
 		// Calculate value
-		float amp = mAudioService->rmsAmplitude.getValue();
+		float amp = getAmplitude(*mAudioService, mEnvelope.get(), band.getValue(), usePeak.getValue());
 		
 		// Map to normalized range
 		amp = gFit(amp, range.getValue().x, range.getValue().y, 0.0f, 1.0f);
@@ -94,7 +107,7 @@ namespace nap
 			return;
 
 		// Calculate value
-		float amp = mAudioService->rmsAmplitude.getValue();
+		float amp = getAmplitude(*mAudioService, mEnvelope.get(), band.getValue(), usePeak.getValue());
 		amp = gFit(amp, range.getValue().x, range.getValue().y, 0.0f, 1.0f);
 		amp = invert.getValue() ? 1.0f - amp : amp;
 
@@ -161,7 +174,7 @@ namespace nap
 			return;
 
 		// Calculate value
-		float amp = mAudioService->rmsAmplitude.getValue();
+		float amp = getAmplitude(*mAudioService, mEnvelope.get(), band.getValue(), usePeak.getValue());
 		amp = gFit(amp, range.getValue().x, range.getValue().y, 0.0f, 1.0f);
 		amp = invert.getValue() ? 1.0f - amp : amp;
 
@@ -208,7 +221,7 @@ namespace nap
 			return;
 
 		// Calculate value
-		float amp = mAudioService->rmsAmplitude.getValue();
+		float amp = getAmplitude(*mAudioService, mEnvelope.get(), band.getValue(), usePeak.getValue());
 		amp = gFit(amp, range.getValue().x, range.getValue().y, 0.0f, 1.0f);
 		amp = invert.getValue() ? 1.0f - amp : amp;
 
@@ -6,6 +6,8 @@
 #include <ofVec2f.h>
 #include <napofattributes.h>
 #include <napofsplinecomponent.h>
+#include <nap/componentdependency.h>
+#include <envelopecomponent.h>
 
 namespace lib
 {
@@ -33,6 +35,8 @@ namespace nap
 		NumericAttribute<float>		scale		{ this, "FinalScale", 1.0f, 0.0f, 1.0f };
 		NumericAttribute<ofVec2f>	range		{ this, "Range", {0.025f, 0.3f}, {0.0f, 0.001f}, {1.0f, 1.0f} };
 		NumericAttribute<float>		damping		{ this, "Damping", 0.05f, 0.0f, 1.0f };
+		NumericAttribute<int>		band		{ this, "Band", 0, 0, Envelope::Band::Count - 1 };		//< 0: full rms, 1: low, 2: mid, 3: high
+		Attribute<bool>				usePeak		{ this, "UsePeak", false };
 
 		// Link
 		Link colorComponent	{ *this };
@@ -44,6 +48,9 @@ namespace nap
 		// Audio service
 		lib::audio::AudioService* mAudioService = nullptr;
 
+		// Band envelopes
+		ComponentDependency<EnvelopeComponent> mEnvelope { this };
+
 		NSLOT(mAdded, const Object&, onAdded)
 		void onAdded(const Object& obj);
 
@@ -70,6 +77,8 @@ namespace nap
 		NumericAttribute<float>		start		{ this, "DefaultValue", 1.0f, 0.0f, 1.0f };
 		NumericAttribute<float>		scale		{ this, "Scale", 1.0f, 0.0f, 2.5f };
 		NumericAttribute<float>		damping		{ this, "Damping", 0.05f, 0.0f, 1.0f };
+		NumericAttribute<int>		band		{ this, "Band", 0, 0, Envelope::Band::Count - 1 };		//< 0: full rms, 1: low, 2: mid, 3: high
+		Attribute<bool>				usePeak		{ this, "UsePeak", false };
 		NumericAttribute<int>		mode		{ this, "BlendMode", 0, 0, 2 };
 
 		// Link
@@ -82,6 +91,9 @@ namespace nap
 		// Audio service
 		lib::audio::AudioService* mAudioService = nullptr;
 
+		// Band envelopes
+		ComponentDependency<EnvelopeComponent> mEnvelope { this };
+
 		NSLOT(mAdded, const Object&, onAdded)
 			void onAdded(const Object& obj);
 
@@ -108,6 +120,8 @@ namespace nap
 		NumericAttribute<float>		start			{ this, "DefaultValue", 0.0f, 0.0f, 100.0f };
 		NumericAttribute<float>		scale			{ this, "Scale", 1.0f, 0.0f, 1080.0f };
 		NumericAttribute<float>		damping			{ this, "Damping", 0.05f, 0.0f, 1.0f };
+		NumericAttribute<int>		band			{ this, "Band", 0, 0, Envelope::Band::Count - 1 };		//< 0: full rms, 1: low, 2: mid, 3: high
+		Attribute<bool>				usePeak			{ this, "UsePeak", false };
 
 		// Link
 		Link rotateLink{ *this };
@@ -119,6 +133,9 @@ namespace nap
 		// Audio service
 		lib::audio::AudioService* mAudioService = nullptr;
 
+		// Band envelopes
+		ComponentDependency<EnvelopeComponent> mEnvelope { this };
+
 		NSLOT(mAdded, const Object&, onAdded)
 			void onAdded(const Object& obj);
 
@@ -145,6 +162,8 @@ namespace nap
 		NumericAttribute<float>		start{ this, "DefaultValue", 0.0f, 0.0f, 10.0f };
 		NumericAttribute<float>		scale{ this, "Scale", 1.0f, 0.0f, 10.0f };
 		NumericAttribute<float>		damping{ this, "Damping", 0.05f, 0.0f, 1.0f };
+		NumericAttribute<int>		band{ this, "Band", 0, 0, Envelope::Band::Count - 1 };		//< 0: full rms, 1: low, 2: mid, 3: high
+		Attribute<bool>				usePeak{ this, "UsePeak", false };
 
 		// Link
 		Link lfoLink{ *this };
@@ -156,6 +175,9 @@ namespace nap
 		// Audio service
 		lib::audio::AudioService* mAudioService = nullptr;
 
+		// Band envelopes
+		ComponentDependency<EnvelopeComponent> mEnvelope { this };
+
 		NSLOT(mAdded, const Object&, onAdded)
 			void onAdded(const Object& obj);
 
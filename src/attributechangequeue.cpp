@@ -0,0 +1,101 @@
+#include <attributechangequeue.h>
+
+namespace nap
+{
+	/**
+	@brief Constructor, allocates the queue up front
+	**/
+	AttributeChangeQueue::AttributeChangeQueue(size_t capacity) : mQueue(capacity)
+	{ }
+
+
+	/**
+	@brief Stages a copy of the mapping, mappings that do not fit wait in the backlog so the order is kept
+	Array attributes are resized while copying, so the audio thread only writes values
+	**/
+	void AttributeChangeQueue::submit(const AttributeMapping& mapping, long long frame)
+	{
+		StagedMapping staged(new StagedAttributeMapping(mapping));
+		if (!mBacklog.empty() || !mQueue.stage({ staged.get(), frame }))
+		{
+			mBacklog.emplace_back(std::move(staged), frame);
+			return;
+		}
+		mSubmitted.emplace_back(std::move(staged));
+	}
+
+
+	/**
+	@brief Publishes all staged mappings
+	**/
+	void AttributeChangeQueue::commit()
+	{
+		mQueue.commit();
+	}
+
+
+	/**
+	@brief Releases the mappings the audio thread is done with, applied mappings are always the oldest submitted
+	Releasing frees the values the audio thread swapped out of the attributes
+	Array attributes are resized here and not when submitted, only once the mapping is due and all before it are applied
+	**/
+	void AttributeChangeQueue::collect()
+	{
+		// Read first, the audio thread publishes the mapping it waits for after the mappings it applied
+		StagedAttributeMapping* waiting = mWaiting.exchange(nullptr, std::memory_order_acquire);
+		size_t applied = mApplied.load(std::memory_order_acquire);
+		for (; mReleased < applied; mReleased++)
+			mSubmitted.pop_front();
+
+		// The audio thread only waits for the oldest mapping it did not apply, a stale pointer never matches a live mapping
+		if (waiting != nullptr && !mSubmitted.empty() && mSubmitted.front().get() == waiting && !waiting->isResolved())
+		{
+			std::lock_guard<std::mutex> lock(mRenderMutex);
+			waiting->resolve();
+		}
+
+		// The backlog is committed as a single batch, together with whatever is staged
+		while (!mBacklog.empty() && mQueue.stage({ mBacklog.front().first.get(), mBacklog.front().second }))
+		{
+			mSubmitted.emplace_back(std::move(mBacklog.front().first));
+			mBacklog.pop_front();
+		}
+		mQueue.commit();
+	}
+
+
+	/**
+	@brief Applies the committed mappings in order up to the first one that is scheduled after this block
+	A due mapping that still has to resize array attributes holds back the ones after it until the main thread resolved it
+	Nothing is allocated or released here
+	**/
+	void AttributeChangeQueue::apply(long long frame)
+	{
+		size_t count = 0;
+		StagedAttributeMapping* waiting = nullptr;
+		Change change;
+		while (mQueue.peek(change) && change.mFrame <= frame)
+		{
+			if (!change.mMapping->isResolved())
+			{
+				waiting = change.mMapping;
+				break;
+			}
+
+			mQueue.pop(change);
+			change.mMapping->apply();
+			count++;
+
+			if (change.mFrame != sImmediate)
+			{
+				mSlack.store(frame - change.mFrame, std::memory_order_relaxed);
+				mScheduledFrame.store(change.mFrame, std::memory_order_release);
+			}
+		}
+
+		if (count > 0)
+			mApplied.fetch_add(count, std::memory_order_release);
+		if (waiting != nullptr)
+			mWaiting.store(waiting, std::memory_order_release);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <attributemapping.h>
+#include <lockfreequeue.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace nap
+{
+	/**
+	@brief Hands attribute mappings from the main thread to the audio thread, where they are applied in between blocks
+	Mappings are submitted and committed as a batch on the main thread, the audio thread applies every committed batch
+	before it renders the next block, so the attributes of a part never change halfway through a block
+	Mappings can be scheduled on the audio clock, they are then applied at the first block that starts at or after their frame
+	Mappings are always applied in submission order, so a scheduled mapping holds back the mappings submitted after it
+	Submitted mappings are copied into a StagedAttributeMapping, the audio thread only writes and swaps values in place
+	Applied copies are released on the main thread in collect(), which frees the replaced values
+	A mapping that resizes array attributes stops the audio thread when it is due, the next collect() resizes the arrays
+	while rendering is excluded, the mapping and the ones after it are then applied at the next block
+	Rendering is excluded with a lock the audio thread only tries to take, a block that can not take it has to be skipped
+	**/
+	class AttributeChangeQueue
+	{
+	public:
+		// Frame of mappings that are applied at the next block
+		static const long long	sImmediate = -1;
+
+		AttributeChangeQueue(size_t capacity);
+
+		// Main thread, adds a copy of the mapping to the current batch, it is applied at the first block that starts at or after @frame
+		void					submit(const AttributeMapping& mapping, long long frame = sImmediate);
+
+		// Main thread, makes the current batch visible to the audio thread at once
+		void					commit();
+
+		// Main thread, releases applied mappings, resolves the mapping the audio thread waits for and submits mappings
+		// that did not fit in the queue, call once per frame
+		void					collect();
+
+		// Audio thread, applies all committed mappings that are due at the block starting at @frame, call before every block
+		void					apply(long long frame);
+
+		// Audio thread, call before rendering, returns false while array attributes are resized, skip rendering then
+		bool					beginRender()								{ return mRenderMutex.try_lock(); }
+
+		// Audio thread, call after rendering when beginRender() returned true
+		void					endRender()									{ mRenderMutex.unlock(); }
+
+		// Number of mappings waiting for room in the queue
+		size_t					getBacklogSize() const						{ return mBacklog.size(); }
+
+		// Frame the last applied scheduled mapping was scheduled at, -1 when none was applied yet
+		long long				getScheduledFrame() const					{ return mScheduledFrame.load(std::memory_order_acquire); }
+
+		// Frames the last scheduled mapping was applied after its frame
+		long long				getSlack() const							{ return mSlack.load(std::memory_order_acquire); }
+
+	private:
+		struct Change
+		{
+			StagedAttributeMapping*	mMapping = nullptr;
+			long long				mFrame = sImmediate;
+		};
+
+		using StagedMapping = std::unique_ptr<StagedAttributeMapping>;
+		using PendingChange = std::pair<StagedMapping, long long>;
+
+		LockFreeQueue<Change>									mQueue;
+		std::deque<StagedMapping>								mSubmitted;		//< Owned by the main thread, in submission order
+		std::deque<PendingChange>								mBacklog;		//< Owned by the main thread, submitted when there is room
+		std::atomic<size_t>										mApplied = { 0 };	//< Mappings applied by the audio thread
+		std::atomic<StagedAttributeMapping*>					mWaiting = { nullptr };	//< Due mapping the audio thread waits for
+		std::mutex												mRenderMutex;	//< Held by the audio thread while rendering
+		size_t													mReleased = 0;		//< Mappings released by the main thread
+		std::atomic<long long>									mScheduledFrame = { -1 };
+		std::atomic<long long>									mSlack = { 0 };
+	};
+}
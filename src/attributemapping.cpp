@@ -0,0 +1,288 @@
+#include <attributemapping.h>
+#include <algorithm>
+
+namespace nap
+{
+	// Only writes the attribute when the value differs, so unchanged attributes do not signal
+	template <typename T>
+	static void setChanged(Object* target, const T& value)
+	{
+		auto attribute = static_cast<Attribute<T>*>(target);
+		if (!(attribute->getValue() == value))
+			attribute->setValue(value);
+	}
+
+
+	/**
+	@brief Adds an attribute write, the value is to be filled in by the caller
+	**/
+	AttributeMapping::Operation& AttributeMapping::add(Type type, Object& target)
+	{
+		mOperations.emplace_back();
+		Operation& operation = mOperations.back();
+		operation.mType = type;
+		operation.mTarget = &target;
+		return operation;
+	}
+
+
+	/**
+	@brief Applies all attribute writes, values that are already set are skipped
+	Array attributes are always written, their elements are separate attributes
+	**/
+	void AttributeMapping::apply() const
+	{
+		for (const auto& operation : mOperations)
+		{
+			switch (operation.mType)
+			{
+			case Type::Int:
+				setChanged(operation.mTarget, operation.mInt);
+				break;
+			case Type::Float:
+				setChanged(operation.mTarget, operation.mFloat);
+				break;
+			case Type::String:
+				setChanged(operation.mTarget, operation.mString);
+				break;
+			case Type::Bool:
+				setChanged(operation.mTarget, operation.mBool);
+				break;
+			case Type::FloatArray:
+				setChanged(operation.mTarget, operation.mFloats);
+				break;
+			case Type::IntArray:
+				setChanged(operation.mTarget, operation.mInts);
+				break;
+			case Type::StringArray:
+				setChanged(operation.mTarget, operation.mStrings);
+				break;
+			case Type::FloatArrayAttribute:
+				static_cast<ArrayAttribute<float>*>(operation.mTarget)->setValues(operation.mFloats);
+				break;
+			case Type::IntArrayAttribute:
+				static_cast<ArrayAttribute<int>*>(operation.mTarget)->setValues(operation.mInts);
+				break;
+			}
+		}
+	}
+
+
+	//////////////////////////////////////////////////////////////////////////
+
+
+	// Writes the value in place without signalling, returns true if it changed
+	template <typename T>
+	static bool writeValue(Object* target, const T& value)
+	{
+		T& current = static_cast<Attribute<T>*>(target)->getValueRef();
+		if (current == value)
+			return false;
+		current = value;
+		return true;
+	}
+
+
+	// Swaps the value in without allocating, the previous value ends up in @value
+	template <typename T>
+	static bool swapValue(Object* target, T& value)
+	{
+		T& current = static_cast<Attribute<T>*>(target)->getValueRef();
+		if (current == value)
+			return false;
+		std::swap(current, value);
+		return true;
+	}
+
+
+	// Writes the elements of an array attribute, elements beyond the number of values are left alone
+	template <typename T>
+	static bool writeElements(const std::vector<Object*>& elements, const std::vector<T>& values)
+	{
+		bool changed = false;
+		size_t count = std::min(elements.size(), values.size());
+		for (size_t i = 0; i < count; i++)
+			changed |= writeValue(elements[i], values[i]);
+		return changed;
+	}
+
+
+	// Signals the current value of the attribute, the value is passed by reference so nothing is copied
+	template <typename T>
+	static void signalValue(Object* target)
+	{
+		auto attribute = static_cast<Attribute<T>*>(target);
+		attribute->valueChangedSignal.trigger(attribute->getValueRef());
+	}
+
+
+	// Limits the value to the range of a clamped numeric attribute, setValue would do the same
+	template <typename T>
+	static void clampValue(Object* target, T& value)
+	{
+		if (!target->getTypeInfo().isKindOf<NumericAttribute<T>>())
+			return;
+
+		auto attribute = static_cast<NumericAttribute<T>*>(target);
+		if (attribute->isClamped())
+			value = std::min(std::max(value, attribute->getMin()), attribute->getMax());
+	}
+
+
+	// Gives the array attribute as many elements as there are values, returns the elements
+	// Elements that already exist keep their value, the new values are written when the mapping is applied
+	template <typename T>
+	static std::vector<Object*> resolveElements(Object* target, const std::vector<T>& values)
+	{
+		auto array = static_cast<ArrayAttribute<T>*>(target);
+		std::vector<Attribute<T>*> elements = array->template getChildrenOfType<Attribute<T>>();
+		if (elements.size() != values.size())
+		{
+			std::vector<T> resized(values);
+			for (size_t i = 0; i < std::min(elements.size(), resized.size()); i++)
+				resized[i] = elements[i]->getValue();
+			array->setValues(resized);
+			elements = array->template getChildrenOfType<Attribute<T>>();
+		}
+		return std::vector<Object*>(elements.begin(), elements.end());
+	}
+
+
+	/**
+	@brief Copies all values, array attributes are left alone until the mapping is resolved
+	**/
+	StagedAttributeMapping::StagedAttributeMapping(const AttributeMapping& mapping)
+	{
+		using Type = AttributeMapping::Type;
+
+		bool resolved = true;
+		mOperations.reserve(mapping.size());
+		for (const auto& operation : mapping.getOperations())
+		{
+			mOperations.emplace_back();
+			Operation& staged = mOperations.back();
+			staged.mOperation = operation;
+			switch (operation.mType)
+			{
+			case Type::Int:
+				clampValue(operation.mTarget, staged.mOperation.mInt);
+				break;
+			case Type::Float:
+				clampValue(operation.mTarget, staged.mOperation.mFloat);
+				break;
+			case Type::FloatArrayAttribute:
+			case Type::IntArrayAttribute:
+				resolved = false;
+				break;
+			default:
+				break;
+			}
+		}
+		mResolved.store(resolved, std::memory_order_relaxed);
+	}
+
+
+	/**
+	@brief The elements are looked up here and not when staged, mappings that were applied before may have resized the array
+	**/
+	void StagedAttributeMapping::resolve()
+	{
+		using Type = AttributeMapping::Type;
+
+		for (auto& staged : mOperations)
+		{
+			const AttributeMapping::Operation& operation = staged.mOperation;
+			if (operation.mType == Type::FloatArrayAttribute)
+				staged.mElements = resolveElements(operation.mTarget, operation.mFloats);
+			else if (operation.mType == Type::IntArrayAttribute)
+				staged.mElements = resolveElements(operation.mTarget, operation.mInts);
+		}
+		mResolved.store(true, std::memory_order_release);
+	}
+
+
+	/**
+	@brief Writes in place or swaps, the values that were replaced stay in the operations until this mapping is destroyed
+	All values are written before any signal is emitted, so slots see the complete mapping, signals follow json order
+	**/
+	void StagedAttributeMapping::apply()
+	{
+		using Type = AttributeMapping::Type;
+
+		for (auto& staged : mOperations)
+		{
+			AttributeMapping::Operation& operation = staged.mOperation;
+			switch (operation.mType)
+			{
+			case Type::Int:
+				staged.mChanged = writeValue(operation.mTarget, operation.mInt);
+				break;
+			case Type::Float:
+				staged.mChanged = writeValue(operation.mTarget, operation.mFloat);
+				break;
+			case Type::String:
+				staged.mChanged = swapValue(operation.mTarget, operation.mString);
+				break;
+			case Type::Bool:
+				staged.mChanged = writeValue(operation.mTarget, operation.mBool);
+				break;
+			case Type::FloatArray:
+				staged.mChanged = swapValue(operation.mTarget, operation.mFloats);
+				break;
+			case Type::IntArray:
+				staged.mChanged = swapValue(operation.mTarget, operation.mInts);
+				break;
+			case Type::StringArray:
+				staged.mChanged = swapValue(operation.mTarget, operation.mStrings);
+				break;
+			case Type::FloatArrayAttribute:
+				staged.mChanged = writeElements(staged.mElements, operation.mFloats);
+				break;
+			case Type::IntArrayAttribute:
+				staged.mChanged = writeElements(staged.mElements, operation.mInts);
+				break;
+			}
+		}
+
+		for (auto& staged : mOperations)
+		{
+			if (!staged.mChanged)
+				continue;
+
+			Object* target = staged.mOperation.mTarget;
+			switch (staged.mOperation.mType)
+			{
+			case Type::Int:
+				signalValue<int>(target);
+				break;
+			case Type::Float:
+				signalValue<float>(target);
+				break;
+			case Type::String:
+				signalValue<std::string>(target);
+				break;
+			case Type::Bool:
+				signalValue<bool>(target);
+				break;
+			case Type::FloatArray:
+				signalValue<nap::FloatArray>(target);
+				break;
+			case Type::IntArray:
+				signalValue<nap::IntArray>(target);
+				break;
+			case Type::StringArray:
+				signalValue<nap::StringArray>(target);
+				break;
+			case Type::FloatArrayAttribute:
+				for (Object* element : staged.mElements)
+					signalValue<float>(element);
+				break;
+			case Type::IntArrayAttribute:
+				for (Object* element : staged.mElements)
+					signalValue<int>(element);
+				break;
+			}
+			staged.mChanged = false;
+		}
+	}
+}
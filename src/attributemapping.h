@@ -0,0 +1,101 @@
+#pragma once
+
+#include <nap/coremodule.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	/**
+	@brief Flat list of typed attribute writes, resolved once from a json object and a target object tree
+	Applying a mapping sets the stored values that differ from the current ones, without walking the json or object tree
+	Created by JsonComponent::compileMapping, only valid as long as the target attributes exist
+	**/
+	class AttributeMapping
+	{
+	public:
+		enum class Type
+		{
+			Int,
+			Float,
+			String,
+			Bool,
+			FloatArray,
+			IntArray,
+			StringArray,
+			FloatArrayAttribute,
+			IntArrayAttribute
+		};
+
+		// A single attribute write
+		struct Operation
+		{
+			Type				mType;
+			Object*				mTarget = nullptr;
+			int					mInt = 0;
+			float				mFloat = 0.0f;
+			bool				mBool = false;
+			std::string			mString;
+			nap::FloatArray		mFloats;
+			nap::IntArray		mInts;
+			nap::StringArray	mStrings;
+		};
+
+		AttributeMapping() = default;
+
+		// Writes all values to their attributes, in the order they appear in the json
+		void					apply() const;
+
+		// Adds an operation
+		Operation&				add(Type type, Object& target);
+
+		// Number of attribute writes
+		size_t					size() const						{ return mOperations.size(); }
+		bool					empty() const						{ return mOperations.empty(); }
+
+		// All attribute writes in json order
+		const std::vector<Operation>& getOperations() const			{ return mOperations; }
+
+	private:
+		std::vector<Operation>	mOperations;
+	};
+
+
+	/**
+	@brief Copy of a mapping that is prepared on the main thread and applied once on the audio thread
+	Applying writes the values in place and swaps strings and arrays in to the attributes, nothing is allocated or freed
+	on the audio thread, the values that were replaced are freed with the mapping on the main thread
+	Attributes that changed signal their new value on the audio thread, right after the mapping is written, so attributes
+	that follow them through a slot or link change in the same block. Slots connected to queued attributes therefore run
+	on the audio thread
+	Array attributes create and destroy an attribute per element when their size changes, a mapping that writes them is
+	resolved on the main thread once it is due, with rendering excluded, see AttributeChangeQueue
+	**/
+	class StagedAttributeMapping
+	{
+	public:
+		// Main thread, copies the values of @mapping, values of clamped numeric attributes are clamped here
+		StagedAttributeMapping(const AttributeMapping& mapping);
+
+		// If the array attributes are resized and their elements resolved, always true when there are none
+		bool					isResolved() const					{ return mResolved.load(std::memory_order_acquire); }
+
+		// Main thread with rendering excluded, sizes the array attributes and resolves their elements
+		void					resolve();
+
+		// Audio thread, writes the values that differ from the current ones and signals them, the mapping has to be resolved
+		void					apply();
+
+	private:
+		struct Operation
+		{
+			AttributeMapping::Operation	mOperation;
+			std::vector<Object*>		mElements;					//< Element attributes of an array attribute
+			bool						mChanged = false;
+		};
+
+		std::vector<Operation>	mOperations;
+		std::atomic<bool>		mResolved = { true };
+	};
+}
@@ -22,11 +22,13 @@
 #include <4dService/SpeakerGridComponent.h>
 #include <4dService/SpatialGranulator.h>
 
+#include <settings.h>
+
 using namespace nap;
 using namespace std;
 
 
-AudioPlayer::AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonComponent& inJsonComponent) : jsonComponent(inJsonComponent)
+AudioPlayer::AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonComponent& inJsonComponent, nap::CompositionTable& inTable, nap::AttributeChangeQueue& inAttributeChanges) : jsonComponent(inJsonComponent), table(inTable), attributeChanges(inAttributeChanges), grainEvents(gGetAppSetting<int>("GrainQueueSize", 1024))
 {
     entity = &root.addEntity(name);
     
@@ -57,6 +59,8 @@ AudioPlayer::AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonCo
     x.setValue(0);
     z.setValue(0);
     size.setValue(3);
+    grainEvents.connect(*granulator);
+    jsonComponent.documentChanged.connect(documentChangedSlot);
     
     // resonator
     resonator = &patchComponent->getPatch().addOperator<lib::audio::ResonatorUnit>("resonator");
@@ -87,6 +91,8 @@ AudioPlayer::AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonCo
         // json settings choosers
         auto& grainSeqChooser = entity->addComponent<nap::JsonChooser>();
         grainSeqChooser.setJsonComponent(jsonComponent);
+        grainSeqChooser.setChangeQueue(attributeChanges);
+        grainSeqChooser.setTable(table);
         grainSeqChooser.setTarget(grainSeq);
         grainSeqChooser.optionsJsonPtr.setValue("/granulatorSequences");
         grainSeq.playing.setName("playing" + to_string(i + 1));
@@ -97,6 +103,8 @@ AudioPlayer::AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonCo
         
         auto& grainInputChooser = entity->addComponent<nap::JsonChooser>();
         grainInputChooser.setJsonComponent(jsonComponent);
+        grainInputChooser.setChangeQueue(attributeChanges);
+        grainInputChooser.setTable(table);
         grainInputChooser.setTarget(grainSeq.sequences);
         grainInputChooser.optionsJsonPtr.setValue("/granulatorInputs");
         grainInputChooser.choice.setName("input audio" + to_string(i + 1));
@@ -104,6 +112,8 @@ AudioPlayer::AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonCo
         
         auto& resSeqChooser = entity->addComponent<nap::JsonChooser>();
         resSeqChooser.setJsonComponent(jsonComponent);
+        resSeqChooser.setChangeQueue(attributeChanges);
+        resSeqChooser.setTable(table);
         resSeqChooser.setTarget(resSeq);
         resSeqChooser.optionsJsonPtr.setValue("/resonatorSequences");
         resSeq.playing.setName("resPlaying" + to_string(i + 1));
@@ -113,31 +123,38 @@ AudioPlayer::AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonCo
         resonatorSequenceChoosers.emplace_back(&resSeqChooser);
     }
     
+    // attributes read by the patch, registered by group so preset changes can be applied to them on the audio thread
+    std::vector<std::pair<OFAttributeWrapper*, nap::Object*>> audio_attributes;
+    auto addAudioAttribute = [&](OFAttributeWrapper& parameters, auto& attribute){
+        parameters.addAttribute(attribute);
+        audio_attributes.emplace_back(&parameters, &attribute);
+    };
+    
     // add granulator parameters
-    grainParameters.addAttribute(granulator->density.proportionAttribute);
-    grainParameters.addAttribute(granulator->position.attribute);
-    grainParameters.addAttribute(granulator->amplitude.proportionAttribute);
-    grainParameters.addAttribute(granulator->amplitudeDev.attribute);
-    grainParameters.addAttribute(granulator->duration.proportionAttribute);
-    grainParameters.addAttribute(granulator->durationDev.attribute);
-    grainParameters.addAttribute(granulator->transpose.attribute);
-    grainParameters.addAttribute(granulator->positionDev.attribute);
-    grainParameters.addAttribute(granulator->irregularity.proportionAttribute);
-    grainParameters.addAttribute(granulator->pitchDev.proportionAttribute);
-    grainParameters.addAttribute(granulator->shape.attribute);
-    grainParameters.addAttribute(granulator->attackDecay.proportionAttribute);
+    addAudioAttribute(grainParameters, granulator->density.proportionAttribute);
+    addAudioAttribute(grainParameters, granulator->position.attribute);
+    addAudioAttribute(grainParameters, granulator->amplitude.proportionAttribute);
+    addAudioAttribute(grainParameters, granulator->amplitudeDev.attribute);
+    addAudioAttribute(grainParameters, granulator->duration.proportionAttribute);
+    addAudioAttribute(grainParameters, granulator->durationDev.attribute);
+    addAudioAttribute(grainParameters, granulator->transpose.attribute);
+    addAudioAttribute(grainParameters, granulator->positionDev.attribute);
+    addAudioAttribute(grainParameters, granulator->irregularity.proportionAttribute);
+    addAudioAttribute(grainParameters, granulator->pitchDev.proportionAttribute);
+    addAudioAttribute(grainParameters, granulator->shape.attribute);
+    addAudioAttribute(grainParameters, granulator->attackDecay.proportionAttribute);
     grainParameters.addAttribute(x);
     grainParameters.addAttribute(z);
     grainParameters.addAttribute(size);
     
     // add resonator parameters
-    resonParameters.addAttribute(resonator->amplitude.attribute);
-    resonParameters.addAttribute(resonator->attack.attribute);
-    resonParameters.addAttribute(resonator->releaseTime.attribute);
-    resonParameters.addAttribute(resonator->damping.proportionAttribute);
-    resonParameters.addAttribute(resonator->feedback.proportionAttribute);
-    resonParameters.addAttribute(resonator->detune.proportionAttribute);
-    resonParameters.addAttribute(resonator->polarity.attribute);
+    addAudioAttribute(resonParameters, resonator->amplitude.attribute);
+    addAudioAttribute(resonParameters, resonator->attack.attribute);
+    addAudioAttribute(resonParameters, resonator->releaseTime.attribute);
+    addAudioAttribute(resonParameters, resonator->damping.proportionAttribute);
+    addAudioAttribute(resonParameters, resonator->feedback.proportionAttribute);
+    addAudioAttribute(resonParameters, resonator->detune.proportionAttribute);
+    addAudioAttribute(resonParameters, resonator->polarity.attribute);
 
     // granulator animators
     createModulator(granulator->density, densityParameters);
@@ -161,6 +178,9 @@ AudioPlayer::AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonCo
     resonParameters.setName("resonator");
     positionParameters.setName("position modulation");
     densityParameters.setName("density modulation");
+    
+    for (auto& audio_attribute : audio_attributes)
+        audioAttributes[audio_attribute.first->getGroup().getName() + "/" + audio_attribute.second->getName()] = audio_attribute.second;
 }
 
 
@@ -215,13 +235,71 @@ void AudioPlayer::setupGui(ofxPanel& panel)
 }
 
 
+// Applies settings saved from the player gui without needing a panel, used for headless rendering
+void AudioPlayer::loadSettings(ofXml& settings, const std::string& name)
+{
+    ofParameterGroup parameters;
+    parameters.setName(name);
+    parameters.add(globalParameters.getGroup());
+    parameters.add(grainParameters.getGroup());
+    parameters.add(positionParameters.getGroup());
+    parameters.add(densityParameters.getGroup());
+    parameters.add(resonParameters.getGroup());
+    settings.deserialize(parameters);
+}
+
+
+nap::Object* AudioPlayer::findAudioAttribute(const std::string& group, const std::string& name) const
+{
+    auto it = audioAttributes.find(group + "/" + name);
+    return it != audioAttributes.end() ? it->second : nullptr;
+}
+
+
+void AudioPlayer::applyPart(const std::string& path, rapidjson::Value& json)
+{
+    // Compiled mappings hold the values of the previous document
+    if (partMappingGeneration != jsonComponent.getGeneration())
+    {
+        partMappings.clear();
+        partMappingGeneration = jsonComponent.getGeneration();
+    }
+    
+    auto it = partMappings.find(path);
+    if (it == partMappings.end())
+        it = partMappings.emplace(path, std::make_shared<AttributeMapping>(jsonComponent.compileMapping(json, patchComponent->getPatch()))).first;
+    attributeChanges.submit(*it->second);
+    attributeChanges.commit();
+    activePart = path;
+}
+
+
+void AudioPlayer::documentChanged(const nap::JsonChanges& changes)
+{
+    if (activePart.empty() || !changes.affects(activePart))
+        return;
+    
+    rapidjson::Value* json = jsonComponent.getValue(activePart);
+    if (!json)
+    {
+        Logger::warn("Active part removed on reload: " + activePart);
+        return;
+    }
+    
+    Logger::debug("Reapplying audio part: " + activePart);
+    applyPart(activePart, *json);
+}
+
+
 
-AudioComposition::AudioComposition(nap::Entity& root, const std::string& jsonPath)
+AudioComposition::AudioComposition(nap::Entity& root, const std::string& jsonPath) : attributeChanges(gGetAppSetting<int>("AttributeQueueSize", 256))
 {    
     entity = &root.addEntity("audio");
     
     jsonComponent = &entity->addComponent<JsonComponent>("json");
+    jsonComponent->libraryCacheSize.setValue(gGetAppSetting<int>("LibraryCacheSize", 64));
     jsonComponent->jsonPath.setValue(jsonPath);
+    jsonComponent->watch.setValue(gGetAppSetting<int>("WatchAudioSettings", 0) != 0);
     
     if (!jsonComponent->isLoaded())
     {
@@ -229,10 +307,12 @@ AudioComposition::AudioComposition(nap::Entity& root, const std::string& jsonPat
         return;
     }
     
+    // validate the composition once, parts are looked up in the table from here on
+    table.build(*jsonComponent);
+    
     // add the audio files
-    std::vector<std::string> audioFileNames = jsonComponent->getStringArray("/audioFiles");
     auto& audioFiles = root.addEntity("audioFiles");
-    for (auto& audioFileName : audioFileNames)
+    for (auto& audioFileName : table.mAudioFiles)
     {
         auto& audioFile = audioFiles.addComponent<lib::audio::AudioFileComponent>();
         audioFile.fileName.setValue(ofFile(audioFileName).getAbsolutePath());
@@ -242,7 +322,7 @@ AudioComposition::AudioComposition(nap::Entity& root, const std::string& jsonPat
     
     // add the player
     for (auto i = 0; i < 2; ++i)
-        players.emplace_back(make_unique<AudioPlayer>(*entity, "player" + to_string(i + 1), *jsonComponent));
+        players.emplace_back(make_unique<AudioPlayer>(*entity, "player" + to_string(i + 1), *jsonComponent, table, attributeChanges));
     
     play(0, "init/1");
     play(1, "init/2");
@@ -254,25 +334,56 @@ AudioComposition::AudioComposition(nap::Entity& root, const std::string& jsonPat
 }
 
 
+void AudioComposition::setGrainEventFrame(long long frame)
+{
+    for (auto& player : players)
+        player->grainEvents.setFrame(frame);
+}
+
+
+void AudioComposition::publishGrainEvents()
+{
+    for (auto& player : players)
+        player->grainEvents.publish();
+}
+
+
+void AudioComposition::collectGrainEvents()
+{
+    for (auto& player : players)
+        player->grainEvents.collect();
+}
+
+
+void AudioComposition::flushAttributeChanges(long long frame)
+{
+    // A change that resizes arrays is resolved by the collect after the apply that found it due
+    attributeChanges.collect();
+    attributeChanges.apply(frame);
+    attributeChanges.collect();
+    attributeChanges.apply(frame);
+    attributeChanges.collect();
+}
+
+
+const nap::CompositionTable& AudioComposition::getTable()
+{
+    table.update(*jsonComponent);
+    return table;
+}
+
+
 void AudioComposition::play(int player, int index)
 {
-    rapidjson::Value* parts = jsonComponent->getValue("/parts");
-    int i = 0;
-    auto it = parts->MemberBegin();
-    while (i != index && it != parts->MemberEnd())
-    {
-        it++;
-        i++;
-    }
-    
-    if (it == parts->MemberEnd())
+    const CompositionSection& parts = getTable().mParts;
+    if (index < 0 || index >= parts.size())
     {
         Logger::warn("Part not found: " + to_string(index));
         return;
     }
     
-    auto name = it->name.GetString();
-    rapidjson::Value* json = &it->value;
+    const std::string& name = parts.mNames[index];
+    rapidjson::Value* json = parts.mValues[index];
     
     if (player >= players.size())
     {
@@ -281,14 +392,14 @@ void AudioComposition::play(int player, int index)
     }
     
     Logger::debug(std::string("Playing audio part: ") + name + " on " + to_string(player));
-    jsonComponent->mapToAttributes(*json, players[player]->patchComponent->getPatch());
+    players[player]->applyPart("/parts/" + name, *json);
     
 }
 
 
 void AudioComposition::play(int player, const std::string& partName)
 {
-    rapidjson::Value* json = jsonComponent->getValue("/" + partName);
+    rapidjson::Value* json = getTable().findPart(partName);
     if (!json)
     {
         Logger::warn("Part not found: " + partName);
@@ -302,6 +413,6 @@ void AudioComposition::play(int player, const std::string& partName)
     }
     
     Logger::debug("Playing audio part: " + partName + " on " + to_string(player));
-    jsonComponent->mapToAttributes(*json, players[player]->patchComponent->getPatch());
+    players[player]->applyPart("/" + partName, *json);
 }
 
@@ -24,6 +24,9 @@
 
 #include <jsoncomponent.h>
 #include <jsonchooser.h>
+#include <graineventbuffer.h>
+#include <attributechangequeue.h>
+#include <compositiontable.h>
 
 #include <Utils/nofattributewrapper.h>
 
@@ -31,10 +34,22 @@
 
 class AudioPlayer {
 public:
-    AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonComponent& jsonComponent);
+    AudioPlayer(nap::Entity& root, const std::string& name, nap::JsonComponent& jsonComponent, nap::CompositionTable& table, nap::AttributeChangeQueue& attributeChanges);
     
     void createModulator(lib::ValueControl& control, OFAttributeWrapper& parameters);
     void setupGui(ofxPanel& panel);
+    void loadSettings(ofXml& settings, const std::string& name);
+    
+    // Attribute read by the patch that is shown as @name in the gui group @group, nullptr for any other parameter
+    // Changes to these attributes can be applied on the audio thread
+    nap::Object* findAudioAttribute(const std::string& group, const std::string& name) const;
+    
+    // Maps a part on to the patch in between audio blocks, the mapping is compiled on first use and cached by path until the json reloads
+    void applyPart(const std::string& path, rapidjson::Value& json);
+    
+    // Reapplies the active part when its json changed on reload
+    void documentChanged(const nap::JsonChanges& changes);
+    NSLOT(documentChangedSlot, const nap::JsonChanges&, documentChanged)
     
     nap::Entity* entity = nullptr;
     spatial::Transform* transform;
@@ -47,6 +62,13 @@ public:
     std::vector<nap::JsonChooser*> grainSequenceChoosers;
     std::vector<nap::JsonChooser*> resonatorSequenceChoosers;
     nap::JsonComponent& jsonComponent;
+    nap::CompositionTable& table;
+    nap::AttributeChangeQueue& attributeChanges;
+    GrainEventBuffer grainEvents;
+    std::unordered_map<std::string, std::shared_ptr<const nap::AttributeMapping>> partMappings;
+    unsigned int partMappingGeneration = 0;
+    std::string activePart;
+    std::unordered_map<std::string, nap::Object*> audioAttributes;
     
     OFAttributeWrapper grainParameters;
     OFAttributeWrapper resonParameters;
@@ -68,12 +90,49 @@ public:
     void play(int player, const std::string& partName);
     
     void setupGuiForPlayer(ofxPanel& panel, int player) { players[player]->setupGui(panel); }
+    void loadSettingsForPlayer(ofXml& settings, int player, const std::string& name) { players[player]->loadSettings(settings, name); }
     nap::Signal<lib::TimeValue, const lib::audio::GrainParameters&>& getGrainSignalForPlayer(int player) { return players[player]->granulator->grainSignal; }
+    GrainEventBuffer& getGrainEventsForPlayer(int player) { return players[player]->grainEvents; }
+    
+    // Stamps the grains of the block that starts at @frame, called from the audio thread before every block
+    void setGrainEventFrame(long long frame);
+    
+    // Publishes the grains of the last block, called from the audio thread after every callback
+    void publishGrainEvents();
+    
+    // Gathers the published grains, called once per frame before the components update
+    void collectGrainEvents();
+    
+    // Applies the parts and options that were changed since the last block, called from the audio thread before every block
+    void applyAttributeChanges(long long frame) { attributeChanges.apply(frame); }
+    
+    // Applies the mapping at the first block that starts at or after @frame on the audio clock
+    void scheduleAttributeChanges(const nap::AttributeMapping& mapping, long long frame) { attributeChanges.submit(mapping, frame); attributeChanges.commit(); }
+    
+    // Frame of the last scheduled change that was applied and the frames it was applied late
+    long long getScheduledFrame() const { return attributeChanges.getScheduledFrame(); }
+    long long getScheduleSlack() const { return attributeChanges.getSlack(); }
+    
+    // Releases the applied changes and resizes the arrays of the change that is due, called once per frame
+    void collectAttributeChanges() { attributeChanges.collect(); }
+    
+    // Applies every change that is due at @frame at once, only when no audio thread is running
+    void flushAttributeChanges(long long frame);
+    
+    // Excludes resizing arrays while the patch renders, called from the audio thread, skip the block when it returns false
+    bool beginRender() { return attributeChanges.beginRender(); }
+    void endRender() { attributeChanges.endRender(); }
     int getPlayerCount() { return players.size(); }
+    nap::Object* findAudioAttribute(int player, const std::string& group, const std::string& name) const { return players[player]->findAudioAttribute(group, name); }
     
 private:
+    // Sections of the loaded composition, rebuilt when the json reloads
+    const nap::CompositionTable& getTable();
+    
     nap::Entity* entity = nullptr;
     nap::JsonComponent* jsonComponent = nullptr;
+    nap::CompositionTable table;
+    nap::AttributeChangeQueue attributeChanges;
     std::vector<std::unique_ptr<AudioPlayer>> players;
 };
 
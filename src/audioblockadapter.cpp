@@ -0,0 +1,75 @@
+#include <audioblockadapter.h>
+#include <Lib/Audio/Unit/AudioService.h>
+#include <algorithm>
+#include <string.h>
+
+/**
+@brief Allocates the fifo for the given internal block size
+**/
+void AudioBlockAdapter::setup(int blockSize, int channelCount)
+{
+	mBlockSize = blockSize;
+	mChannelCount = channelCount;
+	mFifo.assign(blockSize * channelCount, 0.0f);
+	mReadPosition = 0;
+	mAvailable = 0;
+	mLatency = 0;
+}
+
+
+/**
+@brief Renders internal blocks until the device buffer is filled
+**/
+void AudioBlockAdapter::process(lib::audio::AudioService& service, float* output, int frameCount, int channelCount)
+{
+	// Only reallocates when the device channel count differs from the one given on setup
+	if (channelCount != mChannelCount || service.getBufferSize() != mBlockSize)
+		setup(service.getBufferSize(), channelCount);
+
+	int written = 0;
+	while (written < frameCount)
+	{
+		float* current = &output[written * channelCount];
+		int remaining = frameCount - written;
+
+		// Drain what is left from the previous internal block
+		if (mAvailable > 0)
+		{
+			int count = std::min(remaining, mAvailable);
+			memcpy(current, &mFifo[mReadPosition * channelCount], count * channelCount * sizeof(float));
+			mReadPosition += count;
+			mAvailable -= count;
+			written += count;
+			continue;
+		}
+
+		// Enough room for a complete block, render in place
+		if (remaining >= mBlockSize)
+		{
+			renderBlock(service, current, channelCount);
+			written += mBlockSize;
+			continue;
+		}
+
+		// Render into the fifo, the remainder is used by the next callback
+		renderBlock(service, mFifo.data(), channelCount);
+		mReadPosition = 0;
+		mAvailable = mBlockSize;
+	}
+
+	// Frames rendered ahead of the device
+	mLatency = mAvailable;
+}
+
+
+/**
+@brief Changes for the block are applied first, the clock is advanced once the block is rendered
+**/
+void AudioBlockAdapter::renderBlock(lib::audio::AudioService& service, float* output, int channelCount)
+{
+	long long frame = mFrame.load(std::memory_order_relaxed);
+	if (mBlockCallback)
+		mBlockCallback(frame);
+	service.processSamplesInterleaved(nullptr, output, mBlockSize, 0, channelCount);
+	mFrame.store(frame + mBlockSize, std::memory_order_release);
+}
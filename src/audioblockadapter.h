@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace lib
+{
+	namespace audio
+	{
+		class AudioService;
+	}
+}
+
+/**
+@brief Adapts the block size requested by the sound device to the internal block size of the audio service
+Device buffers of any size are filled from internal blocks, left over frames are kept in a fifo of one internal block
+When the device buffer is a multiple of the internal block size (and the fifo is empty) blocks are rendered in place
+The rendered internal blocks make up the audio clock, changes can be applied before every block at an exact frame
+**/
+class AudioBlockAdapter
+{
+public:
+	// Called on the audio thread before every internal block with the frame the block starts at
+	using BlockCallback = std::function<void(long long frame)>;
+
+	AudioBlockAdapter() = default;
+
+	// Allocates the fifo, call before the sound stream is started
+	void					setup(int blockSize, int channelCount);
+
+	// Fills the interleaved output buffer with frameCount frames rendered by the service
+	void					process(lib::audio::AudioService& service, float* output, int frameCount, int channelCount);
+
+	// Frames rendered ahead of the device after the last callback, never more than one internal block
+	int						getLatency() const						{ return mLatency; }
+
+	// Sets the function called before every internal block, set before the sound stream is started
+	void					setBlockCallback(const BlockCallback& callback)	{ mBlockCallback = callback; }
+
+	// Frames rendered since the stream started, the frame the next internal block starts at
+	long long				getFrame() const						{ return mFrame.load(std::memory_order_acquire); }
+
+private:
+	// Renders a single internal block and advances the clock
+	void					renderBlock(lib::audio::AudioService& service, float* output, int channelCount);
+
+	std::vector<float>		mFifo;									//< Holds the remainder of the last rendered internal block
+	int						mBlockSize = 0;
+	int						mChannelCount = 0;
+	int						mReadPosition = 0;						//< Next frame to read from the fifo
+	int						mAvailable = 0;							//< Frames left in the fifo
+	int						mLatency = 0;
+	BlockCallback			mBlockCallback;
+	std::atomic<long long>	mFrame = { 0 };							//< Audio clock, only written by the audio thread
+};
@@ -0,0 +1,148 @@
+#include <audioloadcomponent.h>
+#include <nap/logger.h>
+#include <ofUtils.h>
+#include <cstdlib>
+#include <sstream>
+
+namespace nap
+{
+	// Raises the stored maximum, the main thread resets it concurrently so a plain store could overwrite a reset
+	static void storeMax(std::atomic<uint64_t>& maximum, uint64_t value)
+	{
+		uint64_t current = maximum.load(std::memory_order_relaxed);
+		while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		{ }
+	}
+
+
+	/**
+	@brief Constructor
+	**/
+	AudioLoadComponent::AudioLoadComponent()
+	{
+		reset();
+	}
+
+
+	/**
+	@brief Stores the time it took to process a callback, called from the audio thread
+	**/
+	void AudioLoadComponent::endCallback(const Clock::time_point& start, int frameCount, int sampleRate, int bufferedFrames)
+	{
+		uint64_t busy = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		uint64_t deadline = (uint64_t(frameCount) * 1000000000) / uint64_t(sampleRate);
+		if (deadline == 0)
+			return;
+
+		// Deviation of the interval between callbacks from the expected period
+		if (mHasPreviousStart)
+		{
+			int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(start - mPreviousStart).count();
+			uint64_t deviation = uint64_t(std::abs(interval - int64_t(deadline)));
+			storeMax(mJitterTime, deviation);
+		}
+		mPreviousStart = start;
+		mHasPreviousStart = true;
+
+		// Nominal latency of the frames written this callback, computed from the buffer sizes, not measured at the output
+		uint64_t latency_frames = uint64_t(mDeviceBufferFrames.load(std::memory_order_relaxed) + bufferedFrames);
+		mLatencyTime.store((latency_frames * 1000000000) / uint64_t(sampleRate), std::memory_order_relaxed);
+
+		mBusyTime.fetch_add(busy, std::memory_order_relaxed);
+		mDeadlineTime.fetch_add(deadline, std::memory_order_relaxed);
+		mCallbackCount.fetch_add(1, std::memory_order_relaxed);
+
+		// Late callback
+		if (busy > deadline)
+			mXrunCount.fetch_add(1, std::memory_order_relaxed);
+
+		// Histogram
+		uint64_t bucket = (busy * 10) / deadline;
+		if (bucket >= sBucketCount)
+			bucket = sBucketCount - 1;
+		mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+		// Peak
+		storeMax(mPeakTime, (busy * 100000) / deadline);
+	}
+
+
+	/**
+	@brief Publishes all measurements as attributes
+	**/
+	void AudioLoadComponent::onUpdate()
+	{
+		uint64_t busy_time = mBusyTime.load(std::memory_order_relaxed);
+		uint64_t deadline_time = mDeadlineTime.load(std::memory_order_relaxed);
+
+		// Average load since last update
+		uint64_t busy_diff = busy_time - mPreviousBusyTime;
+		uint64_t deadline_diff = deadline_time - mPreviousDeadlineTime;
+		if (deadline_diff > 0)
+			load.setValue(float(double(busy_diff) / double(deadline_diff) * 100.0));
+		mPreviousBusyTime = busy_time;
+		mPreviousDeadlineTime = deadline_time;
+
+		// Peak load since last update
+		peakLoad.setValue(float(mPeakTime.exchange(0, std::memory_order_relaxed)) / 1000.0f);
+
+		jitter.setValue(float(mJitterTime.exchange(0, std::memory_order_relaxed)) / 1000000.0f);
+		latency.setValue(float(mLatencyTime.load(std::memory_order_relaxed)) / 1000000.0f);
+		xruns.setValue(mXrunCount.load(std::memory_order_relaxed));
+		callbacks.setValue(mCallbackCount.load(std::memory_order_relaxed));
+
+		IntArray buckets(sBucketCount);
+		for (int i = 0; i < sBucketCount; i++)
+			buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+		histogram.setValue(buckets);
+
+		// Log when requested
+		if (logInterval.getValue() <= 0.0f)
+			return;
+
+		float current_time = ofGetElapsedTimef();
+		if (current_time - mPreviousLogTime < logInterval.getValue())
+			return;
+
+		mPreviousLogTime = current_time;
+		logStatistics();
+	}
+
+
+	/**
+	@brief Clears all counters, should not be called while the audio thread is measuring
+	**/
+	void AudioLoadComponent::reset()
+	{
+		mBusyTime.store(0);
+		mDeadlineTime.store(0);
+		mPeakTime.store(0);
+		mXrunCount.store(0);
+		mCallbackCount.store(0);
+		mJitterTime.store(0);
+		mHasPreviousStart = false;
+		for (auto& bucket : mBuckets)
+			bucket.store(0);
+
+		mPreviousBusyTime = 0;
+		mPreviousDeadlineTime = 0;
+	}
+
+
+	/**
+	@brief Logs the current statistics
+	**/
+	void AudioLoadComponent::logStatistics()
+	{
+		std::ostringstream ss;
+		const IntArray& buckets = histogram.getValue();
+		for (int i = 0; i < (int)buckets.size(); i++)
+			ss << (i * 10) << (i == sBucketCount - 1 ? "+%: " : "%: ") << buckets[i] << " ";
+
+		nap::Logger::info("audio load: %.1f%%, peak: %.1f%%, xruns: %d, callbacks: %d, jitter: %.2fms, nominal latency: %.2fms",
+			load.getValue(), peakLoad.getValue(), xruns.getValue(), callbacks.getValue(), jitter.getValue(), latency.getValue());
+		nap::Logger::info("audio callback histogram: %s", ss.str().c_str());
+	}
+}
+
+RTTI_DEFINE(nap::AudioLoadComponent)
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <napofupdatecomponent.h>
+#include <nap/coremodule.h>
+#include <rtti/rtti.h>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace nap
+{
+	/**
+	@brief Measures the time spent in every audio callback against its deadline (bufferSize / sampleRate)
+	Measurements are gathered lock free on the audio thread and published as attributes on update
+	**/
+	class AudioLoadComponent : public OFUpdatableComponent
+	{
+		RTTI_ENABLE_DERIVED_FROM(OFUpdatableComponent)
+
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		// Number of histogram buckets, every bucket covers 10% of the deadline, the last one holds everything over it
+		static const int		sBucketCount = 11;
+
+		AudioLoadComponent();
+
+		// Update call, publishes the measurements
+		virtual void			onUpdate() override;
+
+		// Called from the audio thread around the processing of a callback
+		Clock::time_point		beginCallback() const									{ return Clock::now(); }
+		void					endCallback(const Clock::time_point& start, int frameCount, int sampleRate, int bufferedFrames = 0);
+
+		// Frames the sound device is configured to buffer, used to compute the nominal output latency
+		void					setDeviceBufferFrames(int frameCount)					{ mDeviceBufferFrames = frameCount; }
+
+		// Clears all counters
+		void					reset();
+
+		// Statistics
+		NumericAttribute<float>	load =			{ this, "DSPLoad", 0.0f, 0.0f, 100.0f };		//< Average processing time as percentage of the deadline
+		NumericAttribute<float>	peakLoad =		{ this, "PeakLoad", 0.0f, 0.0f, 100.0f };		//< Highest load of a single callback since last update
+		NumericAttribute<int>	xruns =			{ this, "Xruns", 0, 0, 10000 };					//< Callbacks that took longer than their deadline
+		NumericAttribute<int>	callbacks =		{ this, "Callbacks", 0, 0, 1000000000 };		//< Total number of callbacks measured
+		Attribute<IntArray>		histogram =		{ this, "Histogram" };							//< Callback count per 10% of deadline
+		NumericAttribute<float>	jitter =		{ this, "Jitter", 0.0f, 0.0f, 50.0f };			//< Largest deviation in ms of the callback interval from its period since last update
+		NumericAttribute<float>	latency =		{ this, "NominalLatency", 0.0f, 0.0f, 200.0f };	//< Configured device buffering plus frames rendered ahead in ms, not measured
+		NumericAttribute<float>	logInterval =	{ this, "LogInterval", 0.0f, 0.0f, 60.0f };		//< Logs the statistics every n seconds, 0 disables logging
+
+	private:
+		// Written by the audio thread, read on update
+		std::atomic<uint64_t>	mBusyTime = { 0 };			//< Accumulated processing time in nanoseconds
+		std::atomic<uint64_t>	mDeadlineTime = { 0 };		//< Accumulated deadline time in nanoseconds
+		std::atomic<uint64_t>	mPeakTime = { 0 };			//< Peak load since last update in 1/1000 %
+		std::atomic<int>		mXrunCount = { 0 };
+		std::atomic<int>		mCallbackCount = { 0 };
+		std::atomic<int>		mBuckets[sBucketCount];
+		std::atomic<uint64_t>	mJitterTime = { 0 };		//< Largest interval deviation since last update in nanoseconds
+		std::atomic<uint64_t>	mLatencyTime = { 0 };		//< Output latency of the last callback in nanoseconds
+		Clock::time_point		mPreviousStart;				//< Start of the previous callback, owned by the audio thread
+		bool					mHasPreviousStart = false;
+		std::atomic<int>		mDeviceBufferFrames = { 0 };
+
+		// Values of previous update, used to compute the load over the update interval
+		uint64_t				mPreviousBusyTime = 0;
+		uint64_t				mPreviousDeadlineTime = 0;
+		float					mPreviousLogTime = 0.0f;
+
+		void					logStatistics();
+	};
+}
+
+RTTI_DECLARE(nap::AudioLoadComponent)
@@ -0,0 +1,372 @@
+#include <compiledjson.h>
+#include <nap/logger.h>
+
+#include <rapidjson/error/en.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+namespace nap
+{
+	namespace CompiledJson
+	{
+		static const char		sMagic[4] = { 'S', 'L', 'C', 'J' };
+		static const uint32_t	sVersion = 3;
+
+		enum class ValueType : uint32_t
+		{
+			Null = 0,
+			False,
+			True,
+			Int64,
+			Uint64,
+			Double,
+			String,
+			Array,
+			Object
+		};
+
+		struct Header
+		{
+			char		mMagic[4];
+			uint32_t	mVersion;
+			uint32_t	mValueCount;
+			uint32_t	mStringSize;
+			uint64_t	mSourceSize;
+			int64_t		mSourceModified;
+		};
+
+		// Number values store their bits in mData, strings their offset in the string table
+		struct Record
+		{
+			ValueType	mType;
+			uint32_t	mCount;
+			uint64_t	mData;
+		};
+
+		static_assert(sizeof(Header) == 32 && sizeof(Record) == 16, "compiled json layout changed");
+
+
+		/**
+		@brief Flattens a document in to records and a string table with every string stored once
+		**/
+		class Writer
+		{
+		public:
+			void add(const rapidjson::Value& value)
+			{
+				Record record = { ValueType::Null, 0, 0 };
+				switch (value.GetType())
+				{
+				case rapidjson::kNullType:
+					break;
+				case rapidjson::kFalseType:
+					record.mType = ValueType::False;
+					break;
+				case rapidjson::kTrueType:
+					record.mType = ValueType::True;
+					break;
+				case rapidjson::kNumberType:
+					if (value.IsDouble())
+					{
+						double number = value.GetDouble();
+						record.mType = ValueType::Double;
+						std::memcpy(&record.mData, &number, sizeof(number));
+					}
+					else if (value.IsInt64())
+					{
+						int64_t number = value.GetInt64();
+						record.mType = ValueType::Int64;
+						std::memcpy(&record.mData, &number, sizeof(number));
+					}
+					else
+					{
+						record.mType = ValueType::Uint64;
+						record.mData = value.GetUint64();
+					}
+					break;
+				case rapidjson::kStringType:
+					addString(value.GetString(), value.GetStringLength());
+					return;
+				case rapidjson::kArrayType:
+					record.mType = ValueType::Array;
+					record.mCount = value.Size();
+					mRecords.emplace_back(record);
+					for (auto it = value.Begin(); it != value.End(); ++it)
+						add(*it);
+					return;
+				case rapidjson::kObjectType:
+					record.mType = ValueType::Object;
+					record.mCount = value.MemberCount();
+					mRecords.emplace_back(record);
+					for (auto it = value.MemberBegin(); it != value.MemberEnd(); ++it)
+					{
+						addString(it->name.GetString(), it->name.GetStringLength());
+						add(it->value);
+					}
+					return;
+				}
+				mRecords.emplace_back(record);
+			}
+
+			bool save(const std::string& path, const MappedFile::Info& source) const
+			{
+				// Strings of a loaded document point in to the mapping of the file, it is replaced and never rewritten in place
+				std::string temp_path = path + ".tmp";
+				if (!saveFile(temp_path, source))
+				{
+					std::remove(temp_path.c_str());
+					return false;
+				}
+
+#ifdef _WIN32
+				std::remove(path.c_str());
+#endif
+				if (std::rename(temp_path.c_str(), path.c_str()) != 0)
+				{
+					std::remove(temp_path.c_str());
+					return false;
+				}
+				return true;
+			}
+
+		private:
+			bool saveFile(const std::string& path, const MappedFile::Info& source) const
+			{
+				std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+				if (!stream)
+					return false;
+
+				Header header;
+				std::memcpy(header.mMagic, sMagic, sizeof(sMagic));
+				header.mVersion = sVersion;
+				header.mValueCount = uint32_t(mRecords.size());
+				header.mStringSize = uint32_t(mStrings.size());
+				header.mSourceSize = source.mSize;
+				header.mSourceModified = source.mModified;
+				stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				stream.write(reinterpret_cast<const char*>(mRecords.data()), mRecords.size() * sizeof(Record));
+				stream.write(mStrings.data(), mStrings.size());
+				stream.close();
+				return bool(stream);
+			}
+
+			void addString(const char* data, size_t length)
+			{
+				std::string string(data, length);
+				auto it = mStringOffsets.find(string);
+				if (it == mStringOffsets.end())
+				{
+					it = mStringOffsets.emplace(std::move(string), mStrings.size()).first;
+					mStrings.insert(mStrings.end(), data, data + length);
+					mStrings.emplace_back('\0');
+				}
+				mRecords.push_back({ ValueType::String, uint32_t(length), it->second });
+			}
+
+			std::vector<Record>							mRecords;
+			std::vector<char>							mStrings;
+			std::unordered_map<std::string, uint64_t>	mStringOffsets;
+		};
+
+
+		/**
+		@brief Rebuilds values from the records in order, strings are referenced in the string table
+		**/
+		class Reader
+		{
+		public:
+			Reader(const char* records, uint32_t count, const char* strings, uint32_t stringSize) :
+				mRecords(records), mCount(count), mStrings(strings), mStringSize(stringSize)	{ }
+
+			bool read(rapidjson::Value& outValue, rapidjson::Document::AllocatorType& allocator)
+			{
+				Record record;
+				if (!next(record))
+					return false;
+
+				switch (record.mType)
+				{
+				case ValueType::Null:
+					outValue.SetNull();
+					return true;
+				case ValueType::False:
+					outValue.SetBool(false);
+					return true;
+				case ValueType::True:
+					outValue.SetBool(true);
+					return true;
+				case ValueType::Int64:
+				{
+					int64_t number;
+					std::memcpy(&number, &record.mData, sizeof(number));
+					outValue.SetInt64(number);
+					return true;
+				}
+				case ValueType::Uint64:
+					outValue.SetUint64(record.mData);
+					return true;
+				case ValueType::Double:
+				{
+					double number;
+					std::memcpy(&number, &record.mData, sizeof(number));
+					outValue.SetDouble(number);
+					return true;
+				}
+				case ValueType::String:
+					return getString(record, outValue);
+				case ValueType::Array:
+					outValue.SetArray();
+					outValue.Reserve(record.mCount, allocator);
+					for (uint32_t i = 0; i < record.mCount; i++)
+					{
+						rapidjson::Value element;
+						if (!read(element, allocator))
+							return false;
+						outValue.PushBack(element, allocator);
+					}
+					return true;
+				case ValueType::Object:
+					outValue.SetObject();
+					for (uint32_t i = 0; i < record.mCount; i++)
+					{
+						rapidjson::Value name;
+						rapidjson::Value value;
+						Record name_record;
+						if (!next(name_record) || name_record.mType != ValueType::String || !getString(name_record, name) || !read(value, allocator))
+							return false;
+						outValue.AddMember(name, value, allocator);
+					}
+					return true;
+				}
+				return false;
+			}
+
+			bool isDone() const			{ return mIndex == mCount; }
+
+		private:
+			bool next(Record& outRecord)
+			{
+				if (mIndex >= mCount)
+					return false;
+				std::memcpy(&outRecord, mRecords + size_t(mIndex) * sizeof(Record), sizeof(Record));
+				mIndex++;
+				return true;
+			}
+
+			bool getString(const Record& record, rapidjson::Value& outValue)
+			{
+				if (record.mData + record.mCount >= mStringSize)
+					return false;
+				outValue.SetString(rapidjson::StringRef(mStrings + record.mData, record.mCount));
+				return true;
+			}
+
+			const char*		mRecords;
+			uint32_t		mCount;
+			uint32_t		mIndex = 0;
+			const char*		mStrings;
+			uint32_t		mStringSize;
+		};
+
+
+		/**
+		@brief The compiled file is stored next to the json file
+		**/
+		std::string getPath(const std::string& jsonPath)
+		{
+			return jsonPath + ".bin";
+		}
+
+
+		/**
+		@brief Compares the size and modification time of the json with the ones stored in the header
+		The json is only stat-ed, the time has nanosecond resolution so an edit right after compiling is noticed
+		A missing json file leaves the compiled file up to date
+		**/
+		bool isUpToDate(const std::string& jsonPath)
+		{
+			Header header;
+			std::ifstream stream(getPath(jsonPath), std::ios::binary);
+			if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+				return false;
+			if (std::memcmp(header.mMagic, sMagic, sizeof(sMagic)) != 0 || header.mVersion != sVersion)
+				return false;
+
+			MappedFile::Info json_info;
+			if (!MappedFile::getInfo(jsonPath, json_info))
+				return true;
+			return json_info.mSize == header.mSourceSize && json_info.mModified == header.mSourceModified;
+		}
+
+
+		/**
+		@brief Flattens the value and writes it to disk
+		**/
+		bool write(const rapidjson::Value& root, const std::string& path, const MappedFile::Info& source)
+		{
+			Writer writer;
+			writer.add(root);
+			return writer.save(path, source);
+		}
+
+
+		/**
+		@brief Parses the json file in place and writes the compiled file
+		**/
+		bool compile(const std::string& jsonPath)
+		{
+			// Taken before reading, an edit while compiling leaves the compiled file out of date
+			MappedFile::Info source;
+			MappedFile file;
+			if (!MappedFile::getInfo(jsonPath, source) || !file.open(jsonPath))
+			{
+				Logger::warn("Failed to open " + jsonPath);
+				return false;
+			}
+
+			rapidjson::Document document;
+			rapidjson::ParseResult result = document.ParseInsitu(file.getData());
+			if (document.HasParseError())
+			{
+				Logger::warn("JSON parse error: %s (%u) in '%s'", rapidjson::GetParseError_En(result.Code()), result.Offset(), jsonPath.c_str());
+				return false;
+			}
+
+			std::string path = getPath(jsonPath);
+			if (!write(document, path, source))
+			{
+				Logger::warn("Failed to write " + path);
+				return false;
+			}
+
+			Logger::info("Compiled %s to %s", jsonPath.c_str(), path.c_str());
+			return true;
+		}
+
+
+		/**
+		@brief Validates the header and rebuilds the document from the records
+		**/
+		bool read(MappedFile& file, rapidjson::Document& outDocument)
+		{
+			Header header;
+			if (file.getSize() < sizeof(Header))
+				return false;
+			std::memcpy(&header, file.getData(), sizeof(Header));
+			if (std::memcmp(header.mMagic, sMagic, sizeof(sMagic)) != 0 || header.mVersion != sVersion)
+				return false;
+
+			size_t records_size = size_t(header.mValueCount) * sizeof(Record);
+			if (file.getSize() != sizeof(Header) + records_size + header.mStringSize)
+				return false;
+
+			const char* records = file.getData() + sizeof(Header);
+			Reader reader(records, header.mValueCount, records + records_size, header.mStringSize);
+			return reader.read(outDocument, outDocument.GetAllocator()) && reader.isDone();
+		}
+	}
+}
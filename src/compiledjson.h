@@ -0,0 +1,40 @@
+#pragma once
+
+#include <mappedfile.h>
+
+#include <rapidjson/document.h>
+#include <stdint.h>
+#include <string>
+
+namespace nap
+{
+	/**
+	@brief Binary form of a json document that is loaded without tokenizing
+	The file holds a header, the values of the document flattened in document order and a table of unique strings
+	Every value is a fixed size record, containers store their element count and are followed by their elements
+	Object members are stored as a string record for the name followed by the value
+	Only text parsing is avoided, reading still builds a complete document and attribute mappings are resolved at runtime as before
+	The header stores the size and modification time in nanoseconds of the json it was compiled from, checking them
+	only stats the json, a file that does not match is never used
+	The compiled file is written next to the target and renamed over it, a running instance keeps its mapping of the old file
+	**/
+	namespace CompiledJson
+	{
+		// Path of the compiled file that belongs to a json file
+		std::string			getPath(const std::string& jsonPath);
+
+		// Returns true if the compiled file exists and was compiled from the json file as it is on disk now
+		bool				isUpToDate(const std::string& jsonPath);
+
+		// Writes the value as a compiled file, returns false if the file could not be written
+		// @source identifies the json the value was parsed from
+		bool				write(const rapidjson::Value& root, const std::string& path, const MappedFile::Info& source);
+
+		// Parses the json file and writes it next to it as a compiled file
+		bool				compile(const std::string& jsonPath);
+
+		// Builds the document from a compiled file, strings point in to @file so it has to outlive the document
+		// Returns false if the file is not a compiled document of the current version or is truncated
+		bool				read(MappedFile& file, rapidjson::Document& outDocument);
+	}
+}
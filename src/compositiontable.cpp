@@ -0,0 +1,199 @@
+#include <compositiontable.h>
+#include <nap/logger.h>
+
+namespace nap
+{
+	/**
+	@brief Validates every section, problems are reported once here instead of on every access
+	**/
+	bool CompositionTable::build(JsonComponent& json)
+	{
+		mAudioFiles.clear();
+		mInit = CompositionSection();
+		mGranulatorSequences = CompositionSection();
+		mResonatorSequences = CompositionSection();
+		mGranulatorInputs = CompositionSection();
+		mParts = CompositionSection();
+		mGranulatorSequences.mSequences = true;
+		mResonatorSequences.mSequences = true;
+		mPartPaths.clear();
+		mGeneration = json.getGeneration();
+
+		rapidjson::Value* root = json.isLoaded() ? json.getValue("") : nullptr;
+		if (root == nullptr || !root->IsObject())
+		{
+			Logger::warn("Composition is not a json object");
+			return false;
+		}
+
+		bool valid = true;
+		auto audio_files = root->FindMember("audioFiles");
+		if (audio_files == root->MemberEnd() || !audio_files->value.IsArray())
+		{
+			Logger::warn("Composition section audioFiles is missing or not an array");
+			valid = false;
+		}
+		else
+		{
+			mAudioFiles.reserve(audio_files->value.Size());
+			for (auto it = audio_files->value.Begin(); it != audio_files->value.End(); ++it)
+			{
+				if (it->IsString())
+					mAudioFiles.emplace_back(it->GetString(), it->GetStringLength());
+				else
+				{
+					Logger::warn("Composition audio file %d is not a string", int(it - audio_files->value.Begin()));
+					valid = false;
+				}
+			}
+		}
+
+		valid &= buildSection(json, *root, "init", mInit);
+		valid &= buildSection(json, *root, "granulatorSequences", mGranulatorSequences);
+		valid &= buildSection(json, *root, "resonatorSequences", mResonatorSequences);
+		valid &= buildSection(json, *root, "granulatorInputs", mGranulatorInputs);
+		valid &= buildSection(json, *root, "parts", mParts, false);
+
+		// Parts can be played from the init and parts sections
+		for (int i = 0; i < mInit.size(); i++)
+			mPartPaths.emplace("init/" + mInit.mNames[i], mInit.mValues[i]);
+		for (int i = 0; i < mParts.size(); i++)
+			mPartPaths.emplace("parts/" + mParts.mNames[i], mParts.mValues[i]);
+		return valid;
+	}
+
+
+	/**
+	@brief The generation is compared so every user of the table can call this before reading it
+	**/
+	void CompositionTable::update(JsonComponent& json)
+	{
+		if (mGeneration != json.getGeneration())
+			build(json);
+	}
+
+
+	/**
+	@brief Looks up a part from the init or parts section
+	**/
+	rapidjson::Value* CompositionTable::findPart(const std::string& path) const
+	{
+		auto it = mPartPaths.find(path);
+		return it != mPartPaths.end() ? it->second : nullptr;
+	}
+
+
+	/**
+	@brief Looks up one of the fixed sections, the audio files are not a section
+	**/
+	const CompositionSection* CompositionTable::findSection(const std::string& path) const
+	{
+		if (path == "/init")
+			return &mInit;
+		if (path == "/granulatorSequences")
+			return &mGranulatorSequences;
+		if (path == "/resonatorSequences")
+			return &mResonatorSequences;
+		if (path == "/granulatorInputs")
+			return &mGranulatorInputs;
+		if (path == "/parts")
+			return &mParts;
+		return nullptr;
+	}
+
+
+	/**
+	@brief Every member of a section has to be an object with the shape of the section, other members are left out
+	Libraries are indexed here so their entries can be parsed on selection
+	**/
+	bool CompositionTable::buildSection(JsonComponent& json, rapidjson::Value& root, const std::string& name, CompositionSection& outSection, bool required)
+	{
+		auto section = root.FindMember(name.c_str());
+		if (section != root.MemberEnd() && section->value.IsString())
+		{
+			outSection.mLibrary = json.getLibrary("/" + name);
+			return outSection.mLibrary != nullptr;
+		}
+
+		if (section == root.MemberEnd() && !required)
+			return true;
+
+		if (section == root.MemberEnd() || !section->value.IsObject())
+		{
+			Logger::warn("Composition section %s is missing or not an object", name.c_str());
+			return false;
+		}
+
+		bool valid = true;
+		outSection.mNames.reserve(section->value.MemberCount());
+		outSection.mValues.reserve(section->value.MemberCount());
+		for (auto it = section->value.MemberBegin(); it != section->value.MemberEnd(); ++it)
+		{
+			if (!validateEntry(outSection, name + "/" + it->name.GetString(), it->value))
+			{
+				valid = false;
+				continue;
+			}
+			outSection.mNames.emplace_back(it->name.GetString(), it->name.GetStringLength());
+			outSection.mValues.emplace_back(&it->value);
+		}
+		return valid;
+	}
+
+
+	/**
+	@brief Nested values are checked here so the mappings compiled from an entry can read them without checks
+	**/
+	bool CompositionTable::validateEntry(const CompositionSection& section, const std::string& path, const rapidjson::Value& entry)
+	{
+		if (!entry.IsObject())
+		{
+			Logger::warn("Composition entry %s is not an object", path.c_str());
+			return false;
+		}
+
+		if (!section.mSequences)
+			return true;
+
+		auto times = entry.FindMember("times");
+		if (times == entry.MemberEnd() || !isNumberArray(times->value))
+		{
+			Logger::warn("Composition entry %s times is missing or not an array of numbers", path.c_str());
+			return false;
+		}
+
+		auto sequences = entry.FindMember("sequences");
+		if (sequences == entry.MemberEnd() || !sequences->value.IsObject())
+		{
+			Logger::warn("Composition entry %s sequences is missing or not an object", path.c_str());
+			return false;
+		}
+
+		for (auto it = sequences->value.MemberBegin(); it != sequences->value.MemberEnd(); ++it)
+		{
+			if (!isNumberArray(it->value))
+			{
+				Logger::warn("Composition entry %s sequence %s is not an array of numbers", path.c_str(), it->name.GetString());
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	/**
+	@brief Empty arrays are accepted
+	**/
+	bool CompositionTable::isNumberArray(const rapidjson::Value& value)
+	{
+		if (!value.IsArray())
+			return false;
+
+		for (auto it = value.Begin(); it != value.End(); ++it)
+		{
+			if (!it->IsNumber())
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <jsoncomponent.h>
+
+#include <rapidjson/document.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nap
+{
+	/**
+	@brief Named json objects of one section of the composition, in document order
+	A section can also refer to a library file, its entries are then read from the library on demand
+	**/
+	struct CompositionSection
+	{
+		std::vector<std::string>				mNames;
+		std::vector<rapidjson::Value*>			mValues;
+		JsonLibrary*							mLibrary = nullptr;
+		bool									mSequences = false;					//< Entries are sequences, their times and sequences are validated too
+
+		// Number of entries in the document, library entries are not included
+		int										size() const						{ return int(mValues.size()); }
+	};
+
+
+	/**
+	@brief The sections of an audio composition, validated once when the document is loaded
+	Entries that do not have the expected type are reported and left out, so reading the table needs no checks
+	Values point in to the document of the json component, the table has to be rebuilt when the document changes
+	**/
+	class CompositionTable
+	{
+	public:
+		CompositionTable() = default;
+
+		// Validates the document of the component and fills the table, returns false if anything was left out
+		bool									build(JsonComponent& json);
+
+		// Rebuilds the table when the document of the component changed since it was built
+		void									update(JsonComponent& json);
+
+		// Generation of the document the table was built from
+		unsigned int							getGeneration() const				{ return mGeneration; }
+
+		// Part by path relative to the document root, for example "init/1" or "parts/intro", nullptr if it does not exist
+		rapidjson::Value*						findPart(const std::string& path) const;
+
+		// Section by json pointer, for example "/granulatorSequences", nullptr for anything that is not a section
+		const CompositionSection*				findSection(const std::string& path) const;
+
+		// Checks the shape of an entry of a section, used for library entries that are only parsed on selection
+		// Sequences need a times array of numbers and a sequences object of number arrays, problems are reported under path
+		static bool								validateEntry(const CompositionSection& section, const std::string& path, const rapidjson::Value& entry);
+
+		std::vector<std::string>				mAudioFiles;
+		CompositionSection						mInit;
+		CompositionSection						mGranulatorSequences;
+		CompositionSection						mResonatorSequences;
+		CompositionSection						mGranulatorInputs;
+		CompositionSection						mParts;
+
+	private:
+		// Fills the section with the object members of the object at name, or indexes the library when the section is a path
+		// A section that is not required is left empty when it is missing, returns false if anything was left out
+		bool									buildSection(JsonComponent& json, rapidjson::Value& root, const std::string& name, CompositionSection& outSection, bool required = true);
+
+		// True if every element of the array is a number
+		static bool								isNumberArray(const rapidjson::Value& value);
+
+		std::unordered_map<std::string, rapidjson::Value*> mPartPaths;
+		unsigned int							mGeneration = 0;
+	};
+}
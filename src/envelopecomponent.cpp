@@ -0,0 +1,71 @@
+#include <envelopecomponent.h>
+#include <algorithm>
+#include <math.h>
+
+namespace nap
+{
+	/**
+	@brief Fetches the most recently published envelope
+	**/
+	void EnvelopeComponent::onUpdate()
+	{
+		mEnvelope = &mBuffer.read();
+	}
+
+
+	/**
+	@brief Splits the mono sum of the output in 3 bands using one pole filters and measures rms and peak per band
+	**/
+	void EnvelopeComponent::process(const float* buffer, int frameCount, int channelCount, int sampleRate)
+	{
+		if (frameCount <= 0 || channelCount <= 0)
+			return;
+
+		const float two_pi = 6.283185307f;
+		float low_coeff = 1.0f - expf(-two_pi * lowCrossover.getValue() / float(sampleRate));
+		float high_coeff = 1.0f - expf(-two_pi * highCrossover.getValue() / float(sampleRate));
+
+		float sum[Envelope::Band::Count] = { 0.0f };
+		float peak[Envelope::Band::Count] = { 0.0f };
+		float channel_scale = 1.0f / float(channelCount);
+
+		for (int i = 0; i < frameCount; i++)
+		{
+			float sample = 0.0f;
+			const float* frame = &buffer[i * channelCount];
+			for (int c = 0; c < channelCount; c++)
+				sample += frame[c];
+			sample *= channel_scale;
+
+			mLowState += low_coeff * (sample - mLowState);
+			mHighState += high_coeff * (sample - mHighState);
+
+			float bands[Envelope::Band::Count];
+			bands[Envelope::Band::Full] = sample;
+			bands[Envelope::Band::Low] = mLowState;
+			bands[Envelope::Band::Mid] = mHighState - mLowState;
+			bands[Envelope::Band::High] = sample - mHighState;
+
+			for (int b = 0; b < Envelope::Band::Count; b++)
+			{
+				sum[b] += bands[b] * bands[b];
+				peak[b] = std::max(peak[b], fabsf(bands[b]));
+			}
+		}
+
+		// Peaks fall 60db over the release time
+		float block_time = float(frameCount) / float(sampleRate);
+		float release = powf(0.001f, block_time / std::max(peakRelease.getValue(), 0.001f));
+
+		Envelope& envelope = mBuffer.getWriteBuffer();
+		for (int b = 0; b < Envelope::Band::Count; b++)
+		{
+			mPeak[b] = std::max(peak[b], mPeak[b] * release);
+			envelope.mRms[b] = sqrtf(sum[b] / float(frameCount));
+			envelope.mPeak[b] = mPeak[b];
+		}
+		mBuffer.publish();
+	}
+}
+
+RTTI_DEFINE(nap::EnvelopeComponent)
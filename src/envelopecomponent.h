@@ -0,0 +1,67 @@
+#pragma once
+
+#include <napofupdatecomponent.h>
+#include <nap/coremodule.h>
+#include <rtti/rtti.h>
+#include <triplebuffer.h>
+
+namespace nap
+{
+	/**
+	@brief Envelope of the audio output, split in to frequency bands
+	**/
+	struct Envelope
+	{
+		enum Band
+		{
+			Full = 0,
+			Low,
+			Mid,
+			High,
+			Count
+		};
+
+		float mRms[Band::Count] = { 0.0f };
+		float mPeak[Band::Count] = { 0.0f };
+	};
+
+
+	/**
+	@brief Analyzes the rms and peak envelope of the audio output per frequency band
+	The audio thread analyzes every callback and publishes the result through a triple buffer
+	On update the latest envelope is fetched, consumers read it without locking
+	**/
+	class EnvelopeComponent : public OFUpdatableComponent
+	{
+		RTTI_ENABLE_DERIVED_FROM(OFUpdatableComponent)
+
+	public:
+		EnvelopeComponent() = default;
+
+		// Update call, fetches the latest envelope
+		virtual void			onUpdate() override;
+
+		// Called from the audio thread with the rendered interleaved output
+		void					process(const float* buffer, int frameCount, int channelCount, int sampleRate);
+
+		// Envelope fetched on the last update
+		const Envelope&			getEnvelope() const						{ return *mEnvelope; }
+
+		// Crossover frequencies and peak release
+		NumericAttribute<float>	lowCrossover =	{ this, "LowCrossover", 250.0f, 20.0f, 1000.0f };
+		NumericAttribute<float>	highCrossover =	{ this, "HighCrossover", 4000.0f, 1000.0f, 16000.0f };
+		NumericAttribute<float>	peakRelease =	{ this, "PeakRelease", 0.25f, 0.01f, 2.0f };		//< Time in seconds for a peak to fall by 60dB
+
+	private:
+		TripleBuffer<Envelope>	mBuffer;
+		Envelope				mEmpty;
+		const Envelope*			mEnvelope = &mEmpty;
+
+		// Filter state, owned by the audio thread
+		float					mLowState = 0.0f;
+		float					mHighState = 0.0f;
+		float					mPeak[Envelope::Band::Count] = { 0.0f };
+	};
+}
+
+RTTI_DECLARE(nap::EnvelopeComponent)
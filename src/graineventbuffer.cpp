@@ -0,0 +1,40 @@
+#include <graineventbuffer.h>
+
+/**
+@brief Constructor, allocates all grain storage up front
+**/
+GrainEventBuffer::GrainEventBuffer(size_t capacity) : mQueue(capacity)
+{
+	mEvents.reserve(mQueue.capacity());
+}
+
+
+/**
+@brief Connects to the grain signal of the granulator
+**/
+void GrainEventBuffer::connect(lib::audio::Granulator& granulator)
+{
+	granulator.grainSignal.connect(mGrainTriggered);
+}
+
+
+/**
+@brief Moves all published grains in to the event list of this frame
+**/
+void GrainEventBuffer::collect()
+{
+	mEvents.clear();
+	GrainEvent grain_event;
+	while (mQueue.pop(grain_event))
+		mEvents.emplace_back(grain_event);
+}
+
+
+/**
+@brief Stages the grain, never blocks or allocates
+**/
+void GrainEventBuffer::grainTriggered(const lib::TimeValue& time, const lib::audio::GrainParameters& params)
+{
+	if (!mQueue.stage({ time, mFrame, params }))
+		mOverflowCount.fetch_add(1, std::memory_order_relaxed);
+}
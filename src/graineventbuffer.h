@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Lib/Audio/Unit/Granular/Granulator.h>
+#include <lockfreequeue.h>
+#include <atomic>
+#include <vector>
+
+/**
+@brief Collects every grain fired by a granulator
+Grains are staged on the audio thread and published once per audio callback
+The main thread collects them once per frame, after which consumers iterate over the events of that frame
+**/
+class GrainEventBuffer
+{
+public:
+	// A single grain as fired by the granulator
+	struct GrainEvent
+	{
+		lib::TimeValue					mTime;								//< As passed by the granulator
+		long long						mFrame = 0;							//< Audio clock frame of the block the grain fired in
+		lib::audio::GrainParameters		mParameters;
+	};
+
+	GrainEventBuffer(size_t capacity);
+
+	// Listens to the grain signal of a granulator
+	void								connect(lib::audio::Granulator& granulator);
+
+	// Audio thread, grains fired from now on are stamped with @frame, call before every block
+	void								setFrame(long long frame)				{ mFrame = frame; }
+
+	// Audio thread, makes all grains of the current block visible to the main thread
+	void								publish()								{ mQueue.commit(); }
+
+	// Main thread, gathers the published grains, call once per frame before the consumers update
+	void								collect();
+
+	// Main thread, grains gathered on the last call to collect
+	const std::vector<GrainEvent>&		getEvents() const						{ return mEvents; }
+
+	// Number of grains dropped because the buffer was full
+	int									getOverflowCount() const				{ return mOverflowCount.load(std::memory_order_relaxed); }
+
+	// Max number of grains that can be pending in between collects
+	size_t								getCapacity() const						{ return mQueue.capacity(); }
+
+private:
+	nap::LockFreeQueue<GrainEvent>		mQueue;
+	std::vector<GrainEvent>				mEvents;
+	std::atomic<int>					mOverflowCount = { 0 };
+	long long							mFrame = 0;								//< Only used on the audio thread
+
+	// Stages the grain, called on the audio thread
+	void								grainTriggered(const lib::TimeValue& time, const lib::audio::GrainParameters& params);
+	nap::Slot<lib::TimeValue, const lib::audio::GrainParameters&> mGrainTriggered = { [&](lib::TimeValue time, const lib::audio::GrainParameters& params)
+	{
+		grainTriggered(time, params);
+	} };
+};
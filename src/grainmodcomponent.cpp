@@ -8,51 +8,43 @@ namespace nap
 	// Default constructor
 	GrainModComponent::GrainModComponent()
 	{
-		mPreviousTriggerTime = ofGetElapsedTimef();
 		mEnableUpdates.setValue(false);
 	}
 
 
 	void nap::GrainModComponent::onUpdate()
 	{
-		// Lock for reading
-		mMutex.lock();
-
-		// Initialize default values
-		bool trigger_received = false;
-		lib::TimeValue time(0);
-		lib::audio::GrainParameters params;
-
-		// Copy values thread safe
-		if (mTriggered)
-		{
-			trigger_received = true;
-			params = mTriggerParameters;
-			time = mTriggerTime;
-			mTriggered = false;
-		}
-
-		// Unlock
-		mMutex.unlock();
-
-		// If we haven't received a new trigger, continue
-		if (!trigger_received)
+		if (mGrainEvents == nullptr)
 		{
 			updateParameter();
 			return;
 		}
 
-		// Otherwise check if we are allowed to trigger
-		float current_time = ofGetElapsedTimef();
-		float time_diff = current_time - mPreviousTriggerTime;
-		bool in_time_range = current_time - mPreviousTriggerTime > cutoff.getValue();
-		bool random_allowed = ofRandom(1.0f) < acceptance.getValue();
-		bool amp_allowed = params.amplitude > amp_cutoff.getValue();
+		// Publish buffer statistics
+		const std::vector<GrainEventBuffer::GrainEvent>& grain_events = mGrainEvents->getEvents();
+		if ((int)grain_events.size() > queuePeak.getValue())
+			queuePeak.setValue(grain_events.size());
+
+		int overflows = mGrainEvents->getOverflowCount();
+		if (overflows != queueOverflows.getValue())
+			queueOverflows.setValue(overflows);
 
-		// Trigger if allowed
-		if (in_time_range && random_allowed && amp_allowed)
+		// Check every grain of this frame, the cutoff is measured between the audio blocks the grains fired in
+		for (const auto& grain_event : grain_events)
 		{
-			mPreviousTriggerTime = current_time;
+			lib::TimeValue time = grain_event.mTime;
+			const lib::audio::GrainParameters& params = grain_event.mParameters;
+
+			double grain_time = double(grain_event.mFrame) / mSampleRate;
+			float time_diff = float(grain_time - mPreviousTriggerTime);
+			if (time_diff <= cutoff.getValue() || params.amplitude <= amp_cutoff.getValue())
+				continue;
+
+			// Only candidates draw from the seeded random stream, so the draw rate does not follow the grain density
+			if (ofRandom(1.0f) >= acceptance.getValue())
+				continue;
+
+			mPreviousTriggerTime = grain_time;
 			triggered(time, params, time_diff);
 		}
 
@@ -61,21 +53,12 @@ namespace nap
 	}
 
 
-	// Registers the grain signal
-	void nap::GrainModComponent::registerGrainSignal(AudioComposition& inComposition)
-	{
-		inComposition.getGrainSignalForPlayer(0).connect(mGrainTriggered);
-	}
-
-
-	// Triggers the underlying base class
-	void nap::GrainModComponent::grainTriggered(lib::TimeValue& time, const lib::audio::GrainParameters& params)
+	// Registers the grain buffer of the first player
+	void nap::GrainModComponent::registerGrainSignal(AudioComposition& inComposition, float sampleRate)
 	{
-		mMutex.lock();
-		mTriggered = true;
-		mTriggerTime = time;
-		mTriggerParameters = params;
-		mMutex.unlock();
+		mSampleRate = sampleRate;
+		mGrainEvents = &inComposition.getGrainEventsForPlayer(0);
+		queuePeak.setRange(0, (int)mGrainEvents->getCapacity());
 	}
 
 
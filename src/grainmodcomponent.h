@@ -7,6 +7,7 @@
 #include <audio.h>
 #include <ofTypes.h>
 #include <napofsplinecomponent.h>
+#include <graineventbuffer.h>
 
 namespace nap
 {
@@ -29,30 +30,22 @@ namespace nap
 		NumericAttribute<float>	cutoff =		{ this, "TimeCutoff", 0.0f, 0.0f, 2.0f };			//< Don't except signals under a certain time threshold
 		NumericAttribute<float> amp_cutoff =	{ this, "AmpCutoff", 0.005, 0.0f, 1.0f };
 
-		// Register this component to listen to a grain signal
-		void						registerGrainSignal(AudioComposition& inComposition);
+		// Grain statistics, used to size the grain buffer under heavy densities
+		NumericAttribute<int>	queueOverflows = { this, "QueueOverflows", 0, 0, 10000 };		//< Grains dropped because the buffer was full
+		NumericAttribute<int>	queuePeak =		 { this, "QueuePeak", 0, 0, 1 };				//< Highest number of grains received in between updates
+
+		// Register this component to listen to the grains of a composition rendered at @sampleRate
+		void						registerGrainSignal(AudioComposition& inComposition, float sampleRate);
 
 	private:
+		// Grains of the current frame
+		GrainEventBuffer*			mGrainEvents = nullptr;
+
+		// Sample rate of the audio clock the grains are stamped with
+		float						mSampleRate = 44100.0f;
 
-		// Trigger related values
-		ofMutex						mMutex;
-		lib::TimeValue				mTriggerTime;
-		lib::audio::GrainParameters mTriggerParameters;
-		bool						mTriggered = false;
-
-		// Time
-		float						mPreviousTriggerTime = 0.0f;
-
-		// Slot used when receiving trigger signal
-		void grainTriggered(lib::TimeValue& time, const lib::audio::GrainParameters& params);
-		nap::Slot<lib::TimeValue, const lib::audio::GrainParameters&> mGrainTriggered = { [&](lib::TimeValue time, const lib::audio::GrainParameters& params)
-		{
-			mMutex.lock();
-			mTriggered = true;
-			mTriggerTime = time;
-			mTriggerParameters = params;
-			mMutex.unlock();
-		} };
+		// Time of the last accepted grain on the audio clock, in seconds
+		double						mPreviousTriggerTime = 0.0;
 	};
 
 
@@ -9,6 +9,8 @@
 #include <presetcomponent.h>
 #include <ampcomponent.h>
 #include <grainmodcomponent.h>
+#include <audioloadcomponent.h>
+#include <envelopecomponent.h>
 
 // Sets up the gui using the objects found in ofapp
 void Gui::Setup()
@@ -99,6 +101,9 @@ void Gui::Setup()
 	mPresetAutomationParameters.setName("PresetAutomation");
 	mPresetAutomationParameters.addObject(*mApp.getSession()->getComponent<nap::PresetSwitchComponent>());
 
+	mAudioLoadParameters.setName("AudioLoad");
+	mAudioLoadParameters.addObject(*mApp.getSession()->getComponent<nap::AudioLoadComponent>());
+
 	// Add session parameters to the ui
 	mSessionGui.setup("session");
 	mSessionGui.add(mSessionParameters.getGroup());
@@ -118,12 +123,16 @@ void Gui::Setup()
 
 	mSessionGui.add(mPresetParameters.getGroup());
 	mSessionGui.add(mPresetAutomationParameters.getGroup());
+	mSessionGui.add(mAudioLoadParameters.getGroup());
 
 	mSessionGui.minimizeAll();
 
 
 	//////////////////////////////////////////////////////////////////////////
 
+	mEnvelopeParameters.setName("Envelope");
+	mEnvelopeParameters.addObject(*mApp.getAutomation()->getComponent<nap::EnvelopeComponent>());
+
 	mIntensityParameters.setName("RMSIntensity");
 	mIntensityParameters.addObject(*mApp.getAutomation()->getComponent<nap::AmpIntensityComponent>());
 
@@ -147,6 +156,7 @@ void Gui::Setup()
 
 	mAutomationGui.setup();
 	mAutomationGui.setName("automation");
+	mAutomationGui.add(mEnvelopeParameters.getGroup());
 	mAutomationGui.add(mIntensityParameters.getGroup());
 	mAutomationGui.add(mAmpScaleParameters.getGroup());
 	mAutomationGui.add(mAmpRotateParameters.getGroup());
@@ -164,7 +174,7 @@ void Gui::Setup()
 	{
 		audioGuis.emplace_back(std::make_unique<ofxPanel>());
 		mApp.getAudioComposition()->setupGuiForPlayer(*audioGuis.back(), i);
-		audioGuis.back()->setName("audio player_" + std::to_string(i));
+		audioGuis.back()->setName(getAudioGuiName(i));
 		mGuis.emplace_back(audioGuis.back().get());
 	}
 }
@@ -263,8 +273,8 @@ void Gui::saveAsClicked()
 	nap::PresetComponent* preset_comp = mApp.getSession()->getComponent<nap::PresetComponent>();
 	assert(preset_comp != nullptr);
 	
-	// Reload the presets
-	preset_comp->loadPresets();
+	// Reload the saved preset
+	preset_comp->presetSaved(result.getName());
 }
 
 
@@ -283,8 +293,8 @@ void Gui::saveClicked()
 	SettingSerializer serializer;
 	serializer.saveSettings("saves", current_preset->mPresetName, *this);
 	
-	// Load all presets
-	preset_comp->loadPresets();
+	// Reload the saved preset
+	preset_comp->presetSaved(current_preset->mPresetName);
 }
 
 
@@ -21,6 +21,9 @@ public:
 	// Returns all the available guis
 	const std::vector<ofxPanel*>& getGuis() const	{ return mGuis; }
 
+	// Name of the gui of the audio player with index @player
+	static std::string getAudioGuiName(int player)	{ return "audio player_" + std::to_string(player); }
+
 private:
 	// Reference to the app
 	ofApp& mApp;
@@ -43,6 +46,7 @@ private:
 	OFAttributeWrapper			mSessionParameters;
 	OFAttributeWrapper			mPresetParameters;
 	OFAttributeWrapper			mPresetAutomationParameters;
+	OFAttributeWrapper			mAudioLoadParameters;
 	OFAttributeWrapper			mTagParameters;
 	OFAttributeWrapper			mIntensityParameters;
 	OFAttributeWrapper			mAmpScaleParameters;
@@ -51,6 +55,7 @@ private:
 	OFAttributeWrapper			mGrainTraceParameters;
 	OFAttributeWrapper			mAmpLFOParameters;
 	OFAttributeWrapper			mGrainLfoParameters;
+	OFAttributeWrapper			mEnvelopeParameters;
 
 	// All gui wrappers
 	ofxPanel					mSplineGui;
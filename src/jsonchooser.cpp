@@ -15,41 +15,157 @@ namespace nap {
     
     void JsonChooser::selectChoice(int value)
     {
-        if (mJsonComponent && mTarget)
+        if (mJsonComponent && mTable && mTarget)
         {
-            auto json = mJsonComponent->getValueByIndex(optionsJsonPtr.getValue(), value);
-            if (!json)
+            if (mMappingGeneration != mJsonComponent->getGeneration() || mMappings.empty())
+                compileOptions();
+            
+            // Library entries are parsed and compiled when they are first selected
+            if (mLibrary)
+                compileLibraryOption(value);
+            
+            // Selecting the option that is already applied changes nothing
+            if (value == mAppliedChoice)
+                return;
+            
+            if (value < 0 || value >= (int)mMappings.size() || !mMappings[value])
             {
                 Logger::warn("JsonChooser::choiceChanged(): json entry not found: " + std::to_string(value));
                 return;
             }
             
-            mJsonComponent->mapToAttributes(*json, *mTarget);
+            apply(mMappings[value]);
+            mAppliedChoice = value;
+        }
+    }
+    
+    
+    void JsonChooser::compileOptions()
+    {
+        clearMappings();
+        
+        // The options were validated when the table was built
+        mTable->update(*mJsonComponent);
+        const CompositionSection* options = mTable->findSection(optionsJsonPtr.getValue());
+        if (!options)
+            return;
+        
+        // Options in a library are only counted here
+        mOptions = options;
+        mLibrary = options->mLibrary;
+        if (mLibrary)
+        {
+            mMappings.resize(mLibrary->size());
+            mLibraryRevision = mLibrary->getRevision();
+            return;
+        }
+        
+        mMappings.reserve(options->size());
+        for (rapidjson::Value* json : options->mValues)
+            mMappings.emplace_back(std::make_shared<AttributeMapping>(mJsonComponent->compileMapping(*json, *mTarget)));
+    }
+    
+    
+    void JsonChooser::compileLibraryOption(int index)
+    {
+        // The mappings of a library that changed on disk refer to entries that may have moved
+        if (mLibrary->refresh() || mLibraryRevision != mLibrary->getRevision())
+        {
+            mMappings.assign(mLibrary->size(), nullptr);
+            mCompiledOptions.clear();
+            mLibraryRevision = mLibrary->getRevision();
+            mAppliedChoice = -1;
+        }
+        
+        if (index < 0 || index >= (int)mMappings.size())
+            return;
+        
+        if (mMappings[index])
+        {
+            mCompiledOptions.remove(index);
+            mCompiledOptions.push_front(index);
+            return;
+        }
+        
+        // Library entries are only parsed now, so they are validated now
+        auto json = mLibrary->getEntry(index);
+        if (!json || !CompositionTable::validateEntry(*mOptions, optionsJsonPtr.getValue() + "/" + mLibrary->getName(index), *json))
+            return;
+        
+        // Mappings are dropped together with the entries the library no longer keeps parsed
+        if (mCompiledOptions.size() >= mLibrary->getCacheSize())
+        {
+            mMappings[mCompiledOptions.back()] = nullptr;
+            mCompiledOptions.pop_back();
+        }
+        mMappings[index] = std::make_shared<AttributeMapping>(mJsonComponent->compileMapping(*json, *mTarget));
+        mCompiledOptions.push_front(index);
+    }
+    
+    
+    void JsonChooser::apply(const std::shared_ptr<const AttributeMapping>& mapping)
+    {
+        if (!mChangeQueue)
+        {
+            mapping->apply();
+            return;
         }
+        mChangeQueue->submit(*mapping);
+        mChangeQueue->commit();
+    }
+    
+    
+    void JsonChooser::clearMappings()
+    {
+        mMappings.clear();
+        mCompiledOptions.clear();
+        mOptions = nullptr;
+        mLibrary = nullptr;
+        mAppliedChoice = -1;
+        if (mJsonComponent)
+            mMappingGeneration = mJsonComponent->getGeneration();
     }
     
     
     void JsonChooser::optionsChanged(const std::string& jsonPtr)
     {
-        if (mJsonComponent);
+        clearMappings();
+        if (mJsonComponent && mTable)
         {
-            auto* json = mJsonComponent->getValue(optionsJsonPtr.getValue());
-            if (!json)
+            mTable->update(*mJsonComponent);
+            const CompositionSection* options = mTable->findSection(jsonPtr);
+            if (!options)
             {
-                Logger::warn("JsonChooser::choiceChanged(): json entry not found");
+                Logger::warn("JsonChooser::optionsChanged(): composition section not found: " + jsonPtr);
                 return;
             }
             
-            int numberOfOptions = mJsonComponent->getSize(jsonPtr);
+            int numberOfOptions = options->mLibrary ? options->mLibrary->size() : options->size();
             choice.setRange(0, numberOfOptions - 1);
         }
         selectChoice(choice.getValue());
     }
     
     
+    void JsonChooser::setJsonComponent(JsonComponent& component)
+    {
+        mJsonComponent = &component;
+        mJsonComponent->documentChanged.connect(mDocumentChanged);
+    }
+    
+    
+    void JsonChooser::documentChanged(const JsonChanges& changes)
+    {
+        // Options that did not change keep their values, they are recompiled on the next selection
+        if (changes.affects(optionsJsonPtr.getValue()))
+            optionsChanged(optionsJsonPtr.getValue());
+    }
+    
+    
     void JsonChooser::setTarget(Object& object)
     {
         mTarget = &object;
+        clearMappings();
         selectChoice(choice.getValue());
     }
     
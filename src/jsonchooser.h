@@ -10,12 +10,15 @@
 #define jsonchooser_hpp
 
 #include <stdio.h>
+#include <list>
 
 #include <rtti/rtti.h>
 #include <nap/component.h>
 #include <nap/componentdependency.h>
 #include <nap/link.h>
 #include <jsoncomponent.h>
+#include <compositiontable.h>
+#include <attributechangequeue.h>
 
 namespace nap {
     
@@ -24,7 +27,7 @@ namespace nap {
         RTTI_ENABLE_DERIVED_FROM(Component)
         
     public:
-        // json path where the options entries are specified
+        // json path of the composition section the options are read from
         Attribute<std::string> optionsJsonPtr = { this, "optionsJsonPtr", "", &JsonChooser::optionsChanged };
         
         NumericAttribute<int> choice = { this, "choice", 0, 0, 0, &JsonChooser::choiceChanged };
@@ -33,7 +36,13 @@ namespace nap {
         void setTarget(Object& object);
         
         // TODO use some sort of more flexible component dependency here
-        void setJsonComponent(JsonComponent& component) { mJsonComponent = &component; }
+        void setJsonComponent(JsonComponent& component);
+        
+        // Table the options are read from, it is updated before the options are compiled
+        void setTable(CompositionTable& table) { mTable = &table; }
+        
+        // Options are applied in between audio blocks through the queue, without one they are applied immediately
+        void setChangeQueue(AttributeChangeQueue& queue) { mChangeQueue = &queue; }
         
     private:
         void choiceChanged(const int& value) { selectChoice(value); }
@@ -41,8 +50,43 @@ namespace nap {
         
         void selectChoice(int index);
         
+        // Compiles the mappings of all options at once
+        void compileOptions();
+        
+        // Compiles the library option at @index, the least recently selected option is dropped when the library cache is full
+        void compileLibraryOption(int index);
+        
+        // Drops all compiled options
+        void clearMappings();
+        
+        // Reapplies the current choice when the options changed on reload
+        void documentChanged(const JsonChanges& changes);
+        NSLOT(mDocumentChanged, const JsonChanges&, documentChanged)
+        
+        // Applies the mapping directly or through the change queue
+        void apply(const std::shared_ptr<const AttributeMapping>& mapping);
+        
         JsonComponent* mJsonComponent = nullptr;
+        AttributeChangeQueue* mChangeQueue = nullptr;
+        CompositionTable* mTable = nullptr;
         Object* mTarget = nullptr;
+        
+        // Compiled mapping per option, all options are compiled on first selection
+        std::vector<std::shared_ptr<const AttributeMapping>> mMappings;
+        unsigned int mMappingGeneration = 0;
+        
+        // Section the options were compiled from, library entries are validated against it on selection
+        const CompositionSection* mOptions = nullptr;
+        
+        // Library the options are read from when they are stored in a separate file
+        JsonLibrary* mLibrary = nullptr;
+        unsigned int mLibraryRevision = 0;
+        
+        // Library options that hold a compiled mapping, most recently used first, bounded by the library cache size
+        std::list<int> mCompiledOptions;
+        
+        // Option that was last applied to the target, -1 when the target has to be written again
+        int mAppliedChoice = -1;
     };
     
 }
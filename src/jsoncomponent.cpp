@@ -1,15 +1,39 @@
 
 #include "jsoncomponent.h"
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <tuple>
 #include <nap/logger.h>
+#include <compiledjson.h>
 #include <rapidjson/error/en.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 RTTI_DEFINE(nap::JsonComponent)
 
 using namespace nap;
 
+// Escapes a member name for use in a json pointer
+static std::string escape(const std::string& name)
+{
+    std::string result;
+    for (char c : name)
+    {
+        if (c == '~') result += "~0";
+        else if (c == '/') result += "~1";
+        else result += c;
+    }
+    return result;
+}
+
 template <typename T>
 inline bool contains(const std::vector<T> vec, const T& element)
 {
@@ -18,35 +42,307 @@ inline bool contains(const std::vector<T> vec, const T& element)
 
 namespace nap {
 
-    std::unique_ptr<rapidjson::Document> JsonComponent::loadDocument(const std::string& path)
+    JsonComponent::~JsonComponent()
     {
-        auto document = std::make_unique<rapidjson::Document>();
-
-        rapidjson::ParseResult parseResult;
-
-        std::ifstream fileStream;
-        fileStream.open(path);
-        if (fileStream)
-        {
-            std::stringstream stringStream;
-            stringStream << fileStream.rdbuf();
-            parseResult = document->Parse(stringStream.str().c_str());
-        }
-        else
+        stopWatching();
+    }
+    
+    
+    bool JsonComponent::loadDocument(const std::string& path, LoadedDocument& outDocument)
+    {
+        // Prefer the compiled file when it is newer than the json, it is loaded without parsing
+        if (CompiledJson::isUpToDate(path) && loadCompiledDocument(CompiledJson::getPath(path), outDocument))
+            return true;
+        
+        auto load_start = std::chrono::high_resolution_clock::now();
+        outDocument.mFile = std::make_unique<MappedFile>();
+        if (!outDocument.mFile->open(path))
         {
             Logger::warn("Failed to open " + path);
-            return nullptr;
+            return false;
         }
+        auto parse_start = std::chrono::high_resolution_clock::now();
+        
+        // Allocate the values in chunks that scale with the file, so large compositions need few chunks
+        MappedFile& file = *outDocument.mFile;
+        outDocument.mAllocator = std::make_unique<Allocator>(std::max<size_t>(64 * 1024, file.getSize()));
+        outDocument.mDocument = std::make_unique<rapidjson::Document>(outDocument.mAllocator.get());
+        rapidjson::ParseResult parseResult = outDocument.mDocument->ParseInsitu(file.getData());
+        auto parse_end = std::chrono::high_resolution_clock::now();
+        
+        outDocument.mLoadTime = std::chrono::duration<float, std::milli>(parse_start - load_start).count();
+        outDocument.mParseTime = std::chrono::duration<float, std::milli>(parse_end - parse_start).count();
+        Logger::debug("Loaded %s (%u bytes, %s) in %.2fms, parsed in %.2fms", path.c_str(), (unsigned int)file.getSize(), file.isMapped() ? "mapped" : "read", outDocument.mLoadTime, outDocument.mParseTime);
 
-        if (document->HasParseError())
+        if (outDocument.mDocument->HasParseError())
         {
             Logger::warn("JSON parse error: %s (%u) in '%s'", rapidjson::GetParseError_En(parseResult.Code()), parseResult.Offset(), path.c_str());
         }
-
-        return document;
+        return true;
+    }
+    
+    
+    bool JsonComponent::loadCompiledDocument(const std::string& path, LoadedDocument& outDocument)
+    {
+        auto load_start = std::chrono::high_resolution_clock::now();
+        outDocument.mFile = std::make_unique<MappedFile>();
+        if (!outDocument.mFile->open(path))
+            return false;
+        auto read_start = std::chrono::high_resolution_clock::now();
+        
+        MappedFile& file = *outDocument.mFile;
+        outDocument.mAllocator = std::make_unique<Allocator>(std::max<size_t>(64 * 1024, file.getSize()));
+        outDocument.mDocument = std::make_unique<rapidjson::Document>(outDocument.mAllocator.get());
+        if (!CompiledJson::read(file, *outDocument.mDocument))
+        {
+            Logger::warn("Invalid compiled json %s, loading the json instead", path.c_str());
+            outDocument.mDocument = nullptr;
+            outDocument.mAllocator = nullptr;
+            outDocument.mFile = nullptr;
+            return false;
+        }
+        auto read_end = std::chrono::high_resolution_clock::now();
+        
+        outDocument.mLoadTime = std::chrono::duration<float, std::milli>(read_start - load_start).count();
+        outDocument.mParseTime = std::chrono::duration<float, std::milli>(read_end - read_start).count();
+        Logger::debug("Loaded %s (%u bytes, compiled) in %.2fms, read in %.2fms", path.c_str(), (unsigned int)file.getSize(), outDocument.mLoadTime, outDocument.mParseTime);
+        return true;
     }
 
 
+    void JsonComponent::jsonPathChanged(const std::string& path)
+    {
+        bool watching = mWatching;
+        stopWatching();
+        
+        // The previous document is released when it goes out of scope
+        LoadedDocument document;
+        loadDocument(path, document);
+        std::lock_guard<std::mutex> lock(mReloadMutex);
+        swapDocument(document);
+        mReloadPending = false;
+        
+        if (watching)
+            startWatching();
+    }
+    
+    
+    void JsonComponent::swapDocument(LoadedDocument& document)
+    {
+        mResolvedValues.clear();
+        mRawDocumentContent.clear();
+        
+        // Libraries are opened again for the new document, users rebuild on the generation change
+        mLibraries.clear();
+        
+        std::swap(mFile, document.mFile);
+        std::swap(mAllocator, document.mAllocator);
+        std::swap(mDocument, document.mDocument);
+        std::swap(mLoadTime, document.mLoadTime);
+        std::swap(mParseTime, document.mParseTime);
+        mGeneration++;
+    }
+    
+    
+    void JsonComponent::onUpdate()
+    {
+        if (!mReloadPending)
+            return;
+        
+        // The previous document is released when it goes out of scope, after the lock
+        LoadedDocument previous;
+        JsonChanges changes;
+        {
+            std::lock_guard<std::mutex> lock(mReloadMutex);
+            swapDocument(mPendingDocument);
+            std::swap(previous, mPendingDocument);
+            std::swap(changes, mPendingChanges);
+            mReloadPending = false;
+        }
+        
+        Logger::info("Reloaded %s, %d values changed", jsonPath.getValue().c_str(), (int)changes.mPaths.size());
+        documentChanged.trigger(changes);
+    }
+    
+    
+    void JsonComponent::watchChanged(const bool& value)
+    {
+        if (value)
+            startWatching();
+        else
+            stopWatching();
+    }
+    
+    
+    void JsonComponent::startWatching()
+    {
+        if (mWatching)
+            return;
+        mWatching = true;
+        mWatchThread = std::thread(&JsonComponent::watchFile, this, jsonPath.getValue());
+    }
+    
+    
+    void JsonComponent::stopWatching()
+    {
+        mWatching = false;
+        if (mWatchThread.joinable())
+            mWatchThread.join();
+    }
+    
+    
+    void JsonComponent::watchFile(std::string path)
+    {
+#ifdef __linux__
+        // Watch the directory, editors often replace the file instead of writing it
+        size_t separator = path.find_last_of('/');
+        std::string directory = separator == std::string::npos ? "." : path.substr(0, separator);
+        std::string name = separator == std::string::npos ? path : path.substr(separator + 1);
+        
+        int notify = inotify_init1(IN_NONBLOCK);
+        if (notify >= 0 && inotify_add_watch(notify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) >= 0)
+        {
+            alignas(inotify_event) char buffer[4096];
+            while (mWatching)
+            {
+                pollfd descriptor = { notify, POLLIN, 0 };
+                if (poll(&descriptor, 1, 250) <= 0)
+                    continue;
+                
+                bool changed = false;
+                ssize_t length = 0;
+                while ((length = read(notify, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char* it = buffer; it < buffer + length; )
+                    {
+                        auto event = reinterpret_cast<const inotify_event*>(it);
+                        if (event->len > 0 && name == event->name)
+                            changed = true;
+                        it += sizeof(inotify_event) + event->len;
+                    }
+                }
+                
+                if (changed)
+                    reload(path);
+            }
+            close(notify);
+            return;
+        }
+        
+        Logger::warn("Unable to watch %s, polling instead", path.c_str());
+        if (notify >= 0)
+            close(notify);
+#endif
+        
+        // Poll the modification time
+        struct stat info;
+        time_t modified = stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+        while (mWatching)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            if (stat(path.c_str(), &info) != 0 || info.st_mtime == modified)
+                continue;
+            modified = info.st_mtime;
+            reload(path);
+        }
+    }
+    
+    
+    void JsonComponent::reload(const std::string& path)
+    {
+        LoadedDocument document;
+        if (!loadDocument(path, document))
+            return;
+        
+        if (document.mDocument->HasParseError())
+        {
+            Logger::warn("Not reloading %s, keeping the current document", path.c_str());
+            return;
+        }
+        
+        // The current document is only replaced on update while holding the lock, so it can be read here
+        JsonChanges changes;
+        std::lock_guard<std::mutex> lock(mReloadMutex);
+        if (mDocument)
+            diff(*mDocument, *document.mDocument, "", changes);
+        else
+            changes.mPaths.emplace_back("");
+        
+        if (changes.mPaths.empty())
+            return;
+        
+        // Replaces a document that is still waiting, the changes are relative to the current document
+        std::swap(mPendingDocument, document);
+        std::swap(mPendingChanges, changes);
+        mReloadPending = true;
+    }
+    
+    
+    void JsonComponent::diff(const rapidjson::Value& previous, const rapidjson::Value& current, const std::string& path, JsonChanges& outChanges)
+    {
+        if (!previous.IsObject() || !current.IsObject())
+        {
+            if (previous != current)
+                outChanges.mPaths.emplace_back(path);
+            return;
+        }
+        
+        // Members that were changed or added
+        for (auto it = current.MemberBegin(); it != current.MemberEnd(); ++it)
+        {
+            std::string member_path = path + "/" + escape(it->name.GetString());
+            auto previous_member = previous.FindMember(it->name);
+            if (previous_member == previous.MemberEnd())
+                outChanges.mPaths.emplace_back(member_path);
+            else
+                diff(previous_member->value, it->value, member_path, outChanges);
+        }
+        
+        // Members that were removed
+        for (auto it = previous.MemberBegin(); it != previous.MemberEnd(); ++it)
+        {
+            if (!current.HasMember(it->name))
+                outChanges.mPaths.emplace_back(path + "/" + escape(it->name.GetString()));
+        }
+    }
+    
+    
+    bool JsonChanges::affects(const std::string& jsonPointer) const
+    {
+        for (const auto& path : mPaths)
+        {
+            const std::string& shorter = path.size() < jsonPointer.size() ? path : jsonPointer;
+            const std::string& longer = path.size() < jsonPointer.size() ? jsonPointer : path;
+            if (longer.compare(0, shorter.size(), shorter) != 0)
+                continue;
+            if (longer.size() == shorter.size() || longer[shorter.size()] == '/')
+                return true;
+        }
+        return false;
+    }
+    
+    
+    const std::string& JsonComponent::getRawDocumentContent() const
+    {
+        if (mDocument && mRawDocumentContent.empty())
+        {
+            rapidjson::StringBuffer buffer;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            mDocument->Accept(writer);
+            mRawDocumentContent = buffer.GetString();
+        }
+        return mRawDocumentContent;
+    }
+    
+    
+    rapidjson::Value::Member* JsonComponent::getMemberByIndex(rapidjson::Value& object, int index)
+    {
+        if (!object.IsObject() || index < 0 || index >= (int)object.MemberCount())
+            return nullptr;
+        return &*(object.MemberBegin() + index);
+    }
+    
+    
     std::string JsonComponent::getString(rapidjson::Value& root, const std::string& jsonPointer, const std::string& defaultValue /*= ""*/)
     {
         rapidjson::Value* value = getValue(root, jsonPointer);
@@ -108,9 +404,44 @@ namespace nap {
     }    
 
 
+    const rapidjson::Pointer& JsonComponent::compile(const std::string& jsonPointer)
+    {
+        auto it = mPointers.find(jsonPointer);
+        if (it != mPointers.end())
+            return it->second;
+        
+        auto result = mPointers.emplace(std::piecewise_construct, std::forward_as_tuple(jsonPointer), std::forward_as_tuple(jsonPointer.c_str()));
+        if (!result.first->second.IsValid())
+            Logger::warn("invalid json pointer: " + jsonPointer);
+        return result.first->second;
+    }
+    
+    
+    rapidjson::Value* JsonComponent::getValue(rapidjson::Value& root, const rapidjson::Pointer& jsonPointer)
+    {
+        if (!jsonPointer.IsValid())
+            return nullptr;
+        return jsonPointer.Get(root);
+    }
+    
+    
     rapidjson::Value* JsonComponent::getValue(rapidjson::Value& root, const std::string& jsonPointer)
     {
-        rapidjson::Value* value = rapidjson::Pointer(jsonPointer.c_str()).Get(root);
+        // Lookups from the document root are resolved once per document
+        bool from_document = mDocument != nullptr && &root == mDocument.get();
+        rapidjson::Value* value = nullptr;
+        
+        auto it = from_document ? mResolvedValues.find(jsonPointer) : mResolvedValues.end();
+        if (it != mResolvedValues.end())
+        {
+            value = it->second;
+        }
+        else
+        {
+            value = getValue(root, compile(jsonPointer));
+            if (from_document)
+                mResolvedValues.emplace(jsonPointer, value);
+        }
 
         if (!value)
         {
@@ -123,7 +454,7 @@ namespace nap {
 
     bool JsonComponent::exists(rapidjson::Value& root, const std::string& jsonPointer)
     {
-        return rapidjson::Pointer(jsonPointer.c_str()).Get(root) != nullptr;
+        return getValue(root, compile(jsonPointer)) != nullptr;
     }
 
 
@@ -133,18 +464,10 @@ namespace nap {
 
         if (!object) return nullptr;
 
-        if (object->IsArray()) return getValueFromArray(root, index);
+        if (object->IsArray()) return getValueFromArray(*object, index);
 
-        if (object->IsObject())
-        {
-            auto i = 0;
-            for (auto it = object->MemberBegin(); it != object->MemberEnd(); ++it)
-            {
-                if (i == index) return &it->value;
-                i++;
-            }
-        }
-        return nullptr;
+        auto member = getMemberByIndex(*object, index);
+        return member ? &member->value : nullptr;
     }
 
 
@@ -168,12 +491,7 @@ namespace nap {
             return object->GetArray().Size();
         
         if (object->IsObject())
-        {
-            auto i = 0;
-            for (auto it = object->MemberBegin(); it != object->MemberEnd(); ++it)
-                i++;
-            return i;
-        }
+            return object->MemberCount();
         
         return 0;
         
@@ -182,52 +500,68 @@ namespace nap {
     
     void JsonComponent::mapToAttributes(rapidjson::Value& json, Object& object)
     {
+        compileMapping(json, object).apply();
+    }
+    
+    
+    AttributeMapping JsonComponent::compileMapping(rapidjson::Value& json, Object& object)
+    {
+        AttributeMapping mapping;
+        compileMapping(json, object, mapping);
+        return mapping;
+    }
+    
+    
+    void JsonComponent::compileMapping(rapidjson::Value& json, Object& object, AttributeMapping& mapping)
+    {
+        using Type = AttributeMapping::Type;
+        
         if (object.getTypeInfo().isKindOf<AttributeBase>())
         {
             if (json.IsInt())
             {
                 if (object.getTypeInfo().isKindOf<Attribute<int>>())
-                    static_cast<Attribute<int>*>(&object)->setValue(json.GetInt());
+                    mapping.add(Type::Int, object).mInt = json.GetInt();
                 if (object.getTypeInfo().isKindOf<Attribute<float>>())
-                    static_cast<Attribute<float>*>(&object)->setValue(json.GetInt());
+                    mapping.add(Type::Float, object).mFloat = json.GetInt();
             }
             
             if (json.IsFloat())
             {
                 if (object.getTypeInfo().isKindOf<Attribute<int>>())
-                    static_cast<Attribute<int>*>(&object)->setValue(json.GetFloat());
+                    mapping.add(Type::Int, object).mInt = json.GetFloat();
                 if (object.getTypeInfo().isKindOf<Attribute<float>>())
-                    static_cast<Attribute<float>*>(&object)->setValue(json.GetFloat());
+                    mapping.add(Type::Float, object).mFloat = json.GetFloat();
             }
             
             if (json.IsString())
             {
                 if (object.getTypeInfo().isKindOf<Attribute<std::string>>())
-                    static_cast<Attribute<std::string>*>(&object)->setValue(json.GetString());
+                    mapping.add(Type::String, object).mString = json.GetString();
             }
             
             if (json.IsBool())
             {
                 if (object.getTypeInfo().isKindOf<Attribute<bool>>())
-                    static_cast<Attribute<bool>*>(&object)->setValue(json.GetBool());
+                    mapping.add(Type::Bool, object).mBool = json.GetBool();
             }
             
             if (json.IsArray())
             {
                 if (object.getTypeInfo().isKindOf<Attribute<FloatArray>>())
-                    static_cast<Attribute<FloatArray>*>(&object)->setValue(getNumberArray<float>(json, ""));
+                    mapping.add(Type::FloatArray, object).mFloats = getNumberArray<float>(json, "");
                 
                 if (object.getTypeInfo().isKindOf<Attribute<IntArray>>())
-                    static_cast<Attribute<IntArray>*>(&object)->setValue(getNumberArray<int>(json, ""));
+                    mapping.add(Type::IntArray, object).mInts = getNumberArray<int>(json, "");
                 
                 if (object.getTypeInfo().isKindOf<Attribute<StringArray>>())
-                    static_cast<Attribute<StringArray>*>(&object)->setValue(getStringArray(json, ""));
+                    mapping.add(Type::StringArray, object).mStrings = getStringArray(json, "");
                 
                 if (object.getTypeInfo().isKindOf<ArrayAttribute<float>>())
-                    static_cast<ArrayAttribute<float>&>(object).setValues(getNumberArray<float>(json, ""));
+                    mapping.add(Type::FloatArrayAttribute, object).mFloats = getNumberArray<float>(json, "");
                 
                 if (object.getTypeInfo().isKindOf<ArrayAttribute<int>>())
-                    static_cast<ArrayAttribute<int>&>(object).setValues(getNumberArray<int>(json, ""));
+                    mapping.add(Type::IntArrayAttribute, object).mInts = getNumberArray<int>(json, "");
             }
             
             if (json.IsObject())
@@ -245,25 +579,25 @@ namespace nap {
                         {
                             auto child = attribute.getOrCreateAttribute<std::string>(name);
                             if (child)
-                                child->setValue(it->value.GetString());
+                                mapping.add(Type::String, *child).mString = it->value.GetString();
                         }
                         if (it->value.IsFloat())
                         {
                             auto child = attribute.getOrCreateAttribute<float>(name);
                             if (child)
-                                child->setValue(it->value.GetFloat());
+                                mapping.add(Type::Float, *child).mFloat = it->value.GetFloat();
                         }
                         if (it->value.IsInt())
                         {
                             auto child = attribute.getOrCreateAttribute<int>(name);
                             if (child)
-                                child->setValue(it->value.GetInt());
+                                mapping.add(Type::Int, *child).mInt = it->value.GetInt();
                         }
                         if (it->value.IsObject())
                         {
                             auto child = attribute.getOrCreateCompoundAttribute(name);
                             if (child)
-                                mapToAttributes(it->value, *child);
+                                compileMapping(it->value, *child, mapping);
                         }
                         
                         if (it->value.IsArray())
@@ -281,7 +615,7 @@ namespace nap {
                                     child = attribute.getOrCreateArrayAttribute<std::string>(name);
                             }
                             if (child)
-                                mapToAttributes(it->value, *child);
+                                compileMapping(it->value, *child, mapping);
                         }
                     }
                     
@@ -298,7 +632,7 @@ namespace nap {
                     Object* child = object.getChild(name);
                     if (child)
                     {
-                        mapToAttributes(it->value, *child);
+                        compileMapping(it->value, *child, mapping);
                     }
                 }
             }
@@ -306,6 +640,30 @@ namespace nap {
     }
 
 
+    JsonLibrary* JsonComponent::getLibrary(const std::string& jsonPointer)
+    {
+        rapidjson::Value* value = getValue(jsonPointer);
+        if (!value || !value->IsString())
+            return nullptr;
+        
+        // Library paths are relative to the json file
+        std::string path(value->GetString(), value->GetStringLength());
+        size_t separator = jsonPath.getValue().find_last_of("/\\");
+        if (separator != std::string::npos && !path.empty() && path[0] != '/')
+            path = jsonPath.getValue().substr(0, separator + 1) + path;
+        
+        auto it = mLibraries.find(path);
+        if (it == mLibraries.end())
+        {
+            auto library = std::make_unique<JsonLibrary>(std::max(libraryCacheSize.getValue(), 1));
+            if (!library->open(path))
+                library = nullptr;
+            it = mLibraries.emplace(path, std::move(library)).first;
+        }
+        return it->second.get();
+    }
+    
+    
     std::string JsonComponent::getJSONStringArray(const std::string& jsonPointer)
     {
         // TODO: Replace with rapidjson
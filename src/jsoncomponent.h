@@ -3,27 +3,64 @@
 #include <nap/logger.h>
 #include <nap/component.h>
 #include <nap/coremodule.h>
+#include <napofupdatecomponent.h>
+#include <attributemapping.h>
+#include <mappedfile.h>
+#include <jsonlibrary.h>
 
 #include <rapidjson/document.h>
 #include <rapidjson/pointer.h>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 namespace nap {
     
-    class JsonComponent : public nap::Component
+    // Json pointers to the values that differ between two documents
+    struct JsonChanges
     {
-        RTTI_ENABLE_DERIVED_FROM(nap::Component)
+        std::vector<std::string> mPaths;
+        
+        // Returns true if the value at the path, one of its children or one of its parents changed
+        bool affects(const std::string& jsonPointer) const;
+    };
+    
+    
+    class JsonComponent : public OFUpdatableComponent
+    {
+        RTTI_ENABLE_DERIVED_FROM(OFUpdatableComponent)
     public:
-        // downloads a json document from a host server. Returns a nullptr if the path is invalid or the document failed to
-        // parse properly.
-        std::unique_ptr<rapidjson::Document> loadDocument(const std::string& path);
+        using Allocator = rapidjson::MemoryPoolAllocator<>;
+        
+        JsonComponent() = default;
+        ~JsonComponent();
+        
+        // Swaps in a document that was reloaded in the background
+        virtual void onUpdate() override;
 
         // changes the path to the json file containing info on all the assets on a host
         nap::Attribute<std::string> jsonPath = {this, "jsonPath", "", &JsonComponent::jsonPathChanged};
+        
+        // reloads the document in the background when the file at jsonPath changes
+        nap::Attribute<bool> watch = {this, "watch", false, &JsonComponent::watchChanged};
+        
+        // number of parsed entries kept per library
+        nap::Attribute<int> libraryCacheSize = {this, "libraryCacheSize", 64};
+        
+        // emitted on update after a changed file was swapped in, carries the values that differ from the previous document
+        nap::Signal<const JsonChanges&> documentChanged;
 
         // Checks wether a json entry exists at the location where the jsonPOinter points to
         bool exists(rapidjson::Value& root, const std::string& jsonPointer);
 
+        // Returns the parsed pointer for the given path, pointers are parsed once and cached
+        const rapidjson::Pointer& compile(const std::string& jsonPointer);
+
+        // Return a generic json object using a compiled pointer
+        rapidjson::Value* getValue(rapidjson::Value& root, const rapidjson::Pointer& jsonPointer);
+
         // Return a generic json object
         rapidjson::Value* getValue(rapidjson::Value& root, const std::string& jsonPointer);
         
@@ -53,6 +90,9 @@ namespace nap {
         // Return the number of entries withis this object
         int getSize(rapidjson::Value& root, const std::string& jsonPointer);
         
+        // Return a member of an object by position in constant time, nullptr when out of range
+        rapidjson::Value::Member* getMemberByIndex(rapidjson::Value& object, int index);
+        
         // Return a generic json object using an index into an array
         rapidjson::Value* getValue(const std::string& jsonPointer);
         
@@ -84,22 +124,90 @@ namespace nap {
         // Maps the content of a generic json object to the values of attributes in the nap Object tree
         void mapToAttributes(rapidjson::Value& json, Object& object);
         
+        // Resolves the mapping of a generic json object on to the nap Object tree once, missing compound children are created
+        // Applying the result is equal to calling @mapToAttributes without walking the json or the object tree
+        AttributeMapping compileMapping(rapidjson::Value& json, Object& object);
+        
         // returns wether the json document containing info on all the assets is loaded successfully
         bool isLoaded() const { return mDocument != nullptr; }
 
-        const std::string& getRawDocumentContent() const {
-            return mRawDocumentContent;
-        }
+        // The loaded document as a json string, written on first request as the file buffer is modified while parsing
+        const std::string& getRawDocumentContent() const;
+        
+        // Time in milliseconds it took to read and to parse the current document
+        float getLoadTime() const { return mLoadTime; }
+        float getParseTime() const { return mParseTime; }
 
         // Find and return an array as an actual json string
         std::string getJSONStringArray(const std::string& jsonPointer);
         
+        // Library referenced by the string at the pointer, relative to the directory of the json file
+        // Libraries are opened and indexed on first use and kept open until the next document is loaded, like resolved values
+        // nullptr when the value is not a string or the library failed to open
+        JsonLibrary* getLibrary(const std::string& jsonPointer);
+        
+        // Incremented every time a new document is loaded, resolved values are only valid for one generation
+        unsigned int getGeneration() const { return mGeneration; }
+        
     private:
-        void jsonPathChanged(const std::string& path) { mDocument = loadDocument(path); }
+        // A document together with the memory it lives in, members are destroyed before the memory
+        struct LoadedDocument
+        {
+            std::unique_ptr<MappedFile> mFile = nullptr;
+            std::unique_ptr<Allocator> mAllocator = nullptr;
+            std::unique_ptr<rapidjson::Document> mDocument = nullptr;
+            float mLoadTime = 0.0f;
+            float mParseTime = 0.0f;
+        };
+        
+        // Parses the file in place, returns false if the file could not be opened or parsed
+        static bool loadDocument(const std::string& path, LoadedDocument& outDocument);
+        
+        // Reads a compiled document, returns false if the file is missing or invalid
+        static bool loadCompiledDocument(const std::string& path, LoadedDocument& outDocument);
+        static void diff(const rapidjson::Value& previous, const rapidjson::Value& current, const std::string& path, JsonChanges& outChanges);
+        
+        void jsonPathChanged(const std::string& path);
+        void watchChanged(const bool& value);
+        void compileMapping(rapidjson::Value& json, Object& object, AttributeMapping& mapping);
+        
+        // Makes the loaded document the current one, the previous document is moved in to @document
+        void swapDocument(LoadedDocument& document);
+        
+        // Watches the file and loads it on change, runs on the watch thread
+        void watchFile(std::string path);
+        void reload(const std::string& path);
+        
+        void startWatching();
+        void stopWatching();
+        
+        // file buffer and allocator backing the document, declared first so they are destroyed after it
+        std::unique_ptr<MappedFile> mFile = nullptr;
+        std::unique_ptr<Allocator> mAllocator = nullptr;
         
         // the json document containing info on all the assets
         std::unique_ptr<rapidjson::Document> mDocument = nullptr;
-        std::string mRawDocumentContent;
+        mutable std::string mRawDocumentContent;
+        unsigned int mGeneration = 0;
+        float mLoadTime = 0.0f;
+        float mParseTime = 0.0f;
+        
+        // Parsed pointers by path
+        std::unordered_map<std::string, rapidjson::Pointer> mPointers;
+        
+        // Values resolved from the document root by path, cleared when the document changes
+        std::unordered_map<std::string, rapidjson::Value*> mResolvedValues;
+        
+        // Reloading, the pending document is guarded by the mutex, the current document is only replaced with it held
+        std::thread mWatchThread;
+        std::atomic<bool> mWatching = { false };
+        std::mutex mReloadMutex;
+        std::atomic<bool> mReloadPending = { false };
+        LoadedDocument mPendingDocument;
+        JsonChanges mPendingChanges;
+        
+        // Opened libraries by path, cleared when the document is swapped
+        std::unordered_map<std::string, std::unique_ptr<JsonLibrary>> mLibraries;
     };
     
     
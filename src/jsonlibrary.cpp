@@ -0,0 +1,237 @@
+#include <jsonlibrary.h>
+#include <nap/logger.h>
+
+#include <rapidjson/error/en.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace nap
+{
+	static void skipWhitespace(const char* data, size_t size, size_t& position)
+	{
+		while (position < size && (data[position] == ' ' || data[position] == '\t' || data[position] == '\n' || data[position] == '\r'))
+			position++;
+	}
+
+
+	// Moves past the closing quote of the string that starts at position
+	static bool skipString(const char* data, size_t size, size_t& position)
+	{
+		for (position++; position < size; position++)
+		{
+			if (data[position] == '\\')
+				position++;
+			else if (data[position] == '"')
+			{
+				position++;
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	// Moves past the value that starts at position, nested values are skipped by counting brackets
+	static bool skipValue(const char* data, size_t size, size_t& position)
+	{
+		if (position >= size)
+			return false;
+
+		if (data[position] == '"')
+			return skipString(data, size, position);
+
+		if (data[position] != '{' && data[position] != '[')
+		{
+			while (position < size && data[position] != ',' && data[position] != '}' && data[position] != ']' &&
+				data[position] != ' ' && data[position] != '\t' && data[position] != '\n' && data[position] != '\r')
+				position++;
+			return true;
+		}
+
+		int depth = 0;
+		while (position < size)
+		{
+			char c = data[position];
+			if (c == '"')
+			{
+				if (!skipString(data, size, position))
+					return false;
+				continue;
+			}
+
+			if (c == '{' || c == '[')
+				depth++;
+			else if (c == '}' || c == ']')
+				depth--;
+			position++;
+
+			if (depth == 0)
+				return true;
+		}
+		return false;
+	}
+
+
+	/**
+	@brief Constructor
+	**/
+	JsonLibrary::JsonLibrary(size_t cacheSize) : mCacheSize(std::max<size_t>(cacheSize, 1))
+	{ }
+
+
+	/**
+	@brief Maps the file and indexes the entries, nothing is parsed yet
+	**/
+	bool JsonLibrary::open(const std::string& path)
+	{
+		mPath = path;
+		mEntries.clear();
+		mCache.clear();
+		mCachedEntries.clear();
+		mRevision++;
+
+		// Taken before reading, so a write during the open is picked up by the next refresh
+		mFileInfo = MappedFile::Info();
+		MappedFile::getInfo(path, mFileInfo);
+
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream)
+		{
+			Logger::warn("Failed to open library " + path);
+			return false;
+		}
+
+		// Only kept while indexing
+		std::vector<char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		if (!index(data.data(), data.size()))
+		{
+			Logger::warn("Library %s is not a json object", path.c_str());
+			mEntries.clear();
+			return false;
+		}
+
+		Logger::debug("Indexed %d entries in library %s", size(), path.c_str());
+		return true;
+	}
+
+
+	/**
+	@brief Compares the file on disk with the one that was indexed, both the size and the time in nanoseconds are checked
+	**/
+	bool JsonLibrary::refresh()
+	{
+		MappedFile::Info info;
+		MappedFile::getInfo(mPath, info);
+		if (info.mSize == mFileInfo.mSize && info.mModified == mFileInfo.mModified)
+			return false;
+
+		open(mPath);
+		return true;
+	}
+
+
+	/**
+	@brief Returns the cached entry or parses it, evicting the least recently used entry when the cache is full
+	The file is validated first, so an index is never parsed from a file it was not indexed in
+	**/
+	rapidjson::Value* JsonLibrary::getEntry(int index)
+	{
+		refresh();
+		if (index < 0 || index >= size())
+			return nullptr;
+
+		auto cached = mCachedEntries.find(index);
+		if (cached != mCachedEntries.end())
+		{
+			mCache.splice(mCache.begin(), mCache, cached->second);
+			return mCache.front().second.get();
+		}
+
+		// The range is read on its own, a file that changed after the check above only fails to parse
+		const Entry& entry = mEntries[index];
+		size_t length = entry.mEnd >= entry.mBegin ? entry.mEnd - entry.mBegin : 0;
+		std::ifstream stream(mPath, std::ios::binary);
+		mReadBuffer.resize(length);
+		if (entry.mBegin > entry.mEnd || entry.mEnd > mFileInfo.mSize || !stream.seekg(std::streamoff(entry.mBegin)) || !stream.read(mReadBuffer.data(), length))
+		{
+			Logger::warn("Failed to read '%s' entry %s", mPath.c_str(), entry.mName.c_str());
+			return nullptr;
+		}
+
+		auto document = std::make_unique<rapidjson::Document>();
+		document->Parse(mReadBuffer.data(), length);
+		if (document->HasParseError())
+		{
+			Logger::warn("JSON parse error: %s (%u) in '%s' entry %s", rapidjson::GetParseError_En(document->GetParseError()),
+				unsigned(entry.mBegin + document->GetErrorOffset()), mPath.c_str(), entry.mName.c_str());
+			return nullptr;
+		}
+
+		if (mCache.size() >= mCacheSize)
+		{
+			mCachedEntries.erase(mCache.back().first);
+			mCache.pop_back();
+		}
+
+		mCache.emplace_front(index, std::move(document));
+		mCachedEntries[index] = mCache.begin();
+		return mCache.front().second.get();
+	}
+
+
+	/**
+	@brief Walks the top level object without building values, names are decoded, values are only skipped
+	**/
+	bool JsonLibrary::index(const char* data, size_t size)
+	{
+		size_t position = 0;
+
+		skipWhitespace(data, size, position);
+		if (position >= size || data[position] != '{')
+			return false;
+		position++;
+
+		skipWhitespace(data, size, position);
+		if (position < size && data[position] == '}')
+			return true;
+
+		while (position < size)
+		{
+			// Name, parsed as a json string so escapes are resolved
+			size_t name_begin = position;
+			if (data[position] != '"' || !skipString(data, size, position))
+				return false;
+
+			rapidjson::Document name;
+			name.Parse(data + name_begin, position - name_begin);
+			if (name.HasParseError() || !name.IsString())
+				return false;
+
+			skipWhitespace(data, size, position);
+			if (position >= size || data[position] != ':')
+				return false;
+			position++;
+			skipWhitespace(data, size, position);
+
+			Entry entry;
+			entry.mName.assign(name.GetString(), name.GetStringLength());
+			entry.mBegin = position;
+			if (!skipValue(data, size, position))
+				return false;
+			entry.mEnd = position;
+			mEntries.emplace_back(std::move(entry));
+
+			skipWhitespace(data, size, position);
+			if (position >= size)
+				return false;
+			if (data[position] == '}')
+				return true;
+			if (data[position] != ',')
+				return false;
+			position++;
+			skipWhitespace(data, size, position);
+		}
+		return false;
+	}
+}
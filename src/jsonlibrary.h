@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mappedfile.h>
+
+#include <rapidjson/document.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nap
+{
+	/**
+	@brief Json file with a single object of named entries, of which only the byte ranges are indexed on open
+	Entries are read from the file and parsed when they are requested, the most recently used entries are kept parsed
+	Used for sequence libraries that are too large to keep resident as a whole
+	The file is opened again when its size or modification time changed since it was indexed
+	The file is read instead of mapped, a mapping faults when the file is truncated while it is being rewritten
+	**/
+	class JsonLibrary
+	{
+	public:
+		JsonLibrary(size_t cacheSize);
+
+		// Reads the file and indexes the entries, returns false if the file could not be opened or is not a json object
+		bool							open(const std::string& path);
+
+		// Number of entries
+		int								size() const						{ return int(mEntries.size()); }
+
+		// Name of the entry at @index
+		const std::string&				getName(int index) const			{ return mEntries[index].mName; }
+
+		// Opens the file again when it changed on disk, returns true if it was opened again
+		// Entries and their indices are only valid for the revision they were requested in
+		bool							refresh();
+
+		// Parsed entry at @index of the current file, nullptr when the index is out of range or the entry failed to parse
+		// The value stays valid until @getCacheSize other entries have been requested or the file is opened again
+		rapidjson::Value*				getEntry(int index);
+
+		// Incremented every time the file is opened
+		unsigned int					getRevision() const					{ return mRevision; }
+
+		// Max number of parsed entries kept
+		size_t							getCacheSize() const				{ return mCacheSize; }
+
+		const std::string&				getPath() const						{ return mPath; }
+
+	private:
+		struct Entry
+		{
+			std::string					mName;
+			size_t						mBegin = 0;							//< Offset of the first character of the value
+			size_t						mEnd = 0;							//< Offset past the last character of the value
+		};
+
+		// Parsed entries, most recently used first
+		using CacheList = std::list<std::pair<int, std::unique_ptr<rapidjson::Document>>>;
+
+		// Scans the top level object of @data for the names and value ranges of the entries
+		bool							index(const char* data, size_t size);
+
+		std::string						mPath;
+		MappedFile::Info				mFileInfo;						//< Of the file that was indexed
+		unsigned int					mRevision = 0;
+		std::vector<char>				mReadBuffer;					//< Text of the last entry that was read
+		std::vector<Entry>				mEntries;
+		size_t							mCacheSize = 0;
+		CacheList						mCache;
+		std::unordered_map<int, CacheList::iterator> mCachedEntries;
+	};
+}
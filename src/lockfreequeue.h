@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+namespace nap
+{
+	/**
+	@brief Wait-free single producer / single consumer ring buffer
+	One thread (usually the audio thread) pushes, one other thread (usually the main thread) pops
+	Capacity is rounded up to the next power of two, pushing into a full queue fails instead of blocking
+	**/
+	template <typename T>
+	class LockFreeQueue
+	{
+	public:
+		LockFreeQueue(size_t capacity);
+
+		// Producer side, returns false when the queue is full
+		bool						push(const T& value);
+
+		// Producer side, stores a value without making it visible to the consumer, returns false when the queue is full
+		bool						stage(const T& value);
+
+		// Producer side, makes all staged values visible to the consumer at once
+		void						commit();
+
+		// Consumer side, returns false when the queue is empty
+		bool						pop(T& value);
+
+		// Consumer side, reads the oldest value without removing it, returns false when the queue is empty
+		bool						peek(T& value) const;
+
+		// Number of items currently stored, approximate when called while the other side is active
+		size_t						size() const;
+
+		// Max number of items the queue can hold
+		size_t						capacity() const				{ return mBuffer.size(); }
+
+	private:
+		std::vector<T>				mBuffer;
+		size_t						mMask = 0;
+		std::atomic<size_t>			mHead = { 0 };					//< Next slot to write, owned by the producer
+		std::atomic<size_t>			mTail = { 0 };					//< Next slot to read, owned by the consumer
+		size_t						mStaged = 0;					//< Values written but not yet committed, owned by the producer
+	};
+
+
+	//////////////////////////////////////////////////////////////////////////
+
+
+	template <typename T>
+	LockFreeQueue<T>::LockFreeQueue(size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+		mBuffer.resize(size);
+		mMask = size - 1;
+	}
+
+
+	template <typename T>
+	bool LockFreeQueue<T>::push(const T& value)
+	{
+		if (!stage(value))
+			return false;
+		commit();
+		return true;
+	}
+
+
+	template <typename T>
+	bool LockFreeQueue<T>::stage(const T& value)
+	{
+		size_t head = mHead.load(std::memory_order_relaxed) + mStaged;
+		if (head - mTail.load(std::memory_order_acquire) >= mBuffer.size())
+			return false;
+
+		mBuffer[head & mMask] = value;
+		mStaged++;
+		return true;
+	}
+
+
+	template <typename T>
+	void LockFreeQueue<T>::commit()
+	{
+		if (mStaged == 0)
+			return;
+		mHead.store(mHead.load(std::memory_order_relaxed) + mStaged, std::memory_order_release);
+		mStaged = 0;
+	}
+
+
+	template <typename T>
+	bool LockFreeQueue<T>::pop(T& value)
+	{
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail == mHead.load(std::memory_order_acquire))
+			return false;
+
+		value = mBuffer[tail & mMask];
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+
+	template <typename T>
+	bool LockFreeQueue<T>::peek(T& value) const
+	{
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail == mHead.load(std::memory_order_acquire))
+			return false;
+
+		value = mBuffer[tail & mMask];
+		return true;
+	}
+
+
+	template <typename T>
+	size_t LockFreeQueue<T>::size() const
+	{
+		return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+	}
+}
@@ -2,10 +2,27 @@
 #include <ofApp.h>
 #include <nap/logger.h>
 #include <Utils/nofUtils.h>
+#include <offlinerenderer.h>
+#include <compiledjson.h>
 
 //========================================================================
-int main( )
+int main(int argc, char* argv[])
 {
+	// Compile a json file to its binary form when requested (--compile-json <file.json>)
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (std::string(argv[i]) == "--compile-json")
+			return nap::CompiledJson::compile(argv[i + 1]) ? 0 : -1;
+	}
+
+	// Render offline when requested, no window or sound device is opened
+	OfflineRenderer::Settings render_settings;
+	if (gParseRenderSettings(argc, argv, render_settings))
+	{
+		OfflineRenderer renderer;
+		return renderer.render(render_settings) ? 0 : -1;
+	}
+
 	ofGLWindowSettings window_settings;
 	window_settings.glVersionMajor = 3;
 	window_settings.glVersionMinor = 3;
@@ -0,0 +1,129 @@
+#include <mappedfile.h>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace nap
+{
+	/**
+	@brief Stats the file, the nanoseconds are needed to notice an edit made within the same second
+	**/
+	bool MappedFile::getInfo(const std::string& path, Info& outInfo)
+	{
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+			return false;
+
+		outInfo.mSize = uint64_t(info.st_size);
+#if defined(__APPLE__)
+		outInfo.mModified = int64_t(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+		outInfo.mModified = int64_t(info.st_mtime) * 1000000000;
+#else
+		outInfo.mModified = int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+		return true;
+	}
+
+
+	/**
+	@brief Destructor
+	**/
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+
+	/**
+	@brief Maps the file in to memory, falls back to reading when mapping is not possible
+	**/
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+#ifndef _WIN32
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(file, &info) != 0)
+		{
+			::close(file);
+			return false;
+		}
+
+		// The terminating 0 comes from the zero filled remainder of the last page
+		size_t size = size_t(info.st_size);
+		long page_size = sysconf(_SC_PAGESIZE);
+		if (size == 0 || page_size <= 0 || size % size_t(page_size) == 0)
+		{
+			::close(file);
+			return read(path);
+		}
+
+		void* data = mmap(nullptr, size + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		::close(file);
+		if (data == MAP_FAILED)
+			return read(path);
+
+		mData = static_cast<char*>(data);
+		mSize = size;
+		mMapped = true;
+		return true;
+#else
+		return read(path);
+#endif
+	}
+
+
+	/**
+	@brief Releases the mapping or buffer
+	**/
+	void MappedFile::close()
+	{
+#ifndef _WIN32
+		if (mMapped)
+			munmap(mData, mSize + 1);
+#endif
+		mData = nullptr;
+		mSize = 0;
+		mMapped = false;
+		mBuffer.clear();
+		mBuffer.shrink_to_fit();
+	}
+
+
+	/**
+	@brief Reads the file in to the owned buffer
+	**/
+	bool MappedFile::read(const std::string& path)
+	{
+		std::ifstream stream(path, std::ios::binary | std::ios::ate);
+		if (!stream)
+			return false;
+
+		std::streamoff size = stream.tellg();
+		if (size < 0)
+			return false;
+		stream.seekg(0, std::ios::beg);
+
+		mBuffer.resize(size_t(size) + 1);
+		if (size > 0 && !stream.read(mBuffer.data(), size))
+		{
+			mBuffer.clear();
+			return false;
+		}
+		mBuffer[size_t(size)] = 0;
+
+		mData = mBuffer.data();
+		mSize = size_t(size);
+		return true;
+	}
+}
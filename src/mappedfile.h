@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	/**
+	@brief Writable private view of a file, terminated with a 0 so it can be parsed in place
+	On posix systems the file is memory mapped copy on write, changes are never written back
+	Other platforms, and files that end exactly on a page boundary, are read in to a single owned buffer
+	**/
+	class MappedFile
+	{
+	public:
+		// Size and modification time of a file on disk
+		struct Info
+		{
+			uint64_t		mSize = 0;
+			int64_t			mModified = 0;			//< Nanoseconds, only seconds where the platform has no finer time
+		};
+
+		// Reads the size and modification time of the file, returns false if it does not exist
+		static bool			getInfo(const std::string& path, Info& outInfo);
+
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// Maps the file, returns false if the file could not be opened
+		bool				open(const std::string& path);
+
+		// Unmaps the file
+		void				close();
+
+		// File content, followed by a terminating 0
+		char*				getData()						{ return mData; }
+		size_t				getSize() const					{ return mSize; }
+
+		// If the content is memory mapped instead of read
+		bool				isMapped() const				{ return mMapped; }
+
+	private:
+		bool				read(const std::string& path);
+
+		char*				mData = nullptr;
+		size_t				mSize = 0;
+		bool				mMapped = false;
+		std::vector<char>	mBuffer;
+	};
+}
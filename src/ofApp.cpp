@@ -20,6 +20,8 @@
 #include <ampcomponent.h>
 #include <napoftransform.h>
 #include <grainmodcomponent.h>
+#include <audioloadcomponent.h>
+#include <envelopecomponent.h>
 
 // Utils
 #include <splineutils.h>
@@ -30,6 +32,8 @@
 // Gui
 #include <gui.h>
 #include <assert.h>
+#include <chrono>
+#include <string.h>
 
 using namespace lib;
 using namespace lib::audio;
@@ -64,6 +68,9 @@ void ofApp::setup()
 	// Create automation
 	createAutomation();
 
+	// Open the sound device, all audio thread consumers exist now
+	startAudio();
+
 	// Setup gui (always last)
 	setupGui();
 }
@@ -72,8 +79,12 @@ void ofApp::setup()
 // Update
 void ofApp::update()
 {
+	audioComposition->collectGrainEvents();
+	audioComposition->collectAttributeChanges();
 	mOFService->update();
     schedulerService->process(ofGetLastFrameTime() * 1000.);
+	applyPendingPreset();
+	prepareNextPreset();
 }
 
 //--------------------------------------------------------------
@@ -230,12 +241,27 @@ void ofApp::gotMessage(ofMessage msg){
 // Output sound gathered by output service
 void ofApp::audioOut(float * output, int bufferSize, int nChannels)
 {
-	int i = 0;
-	while (i < (bufferSize * nChannels) - 1)
+	nap::AudioLoadComponent::Clock::time_point start_time;
+	if (mAudioLoad != nullptr)
+		start_time = mAudioLoad->beginCallback();
+
+	// Arrays of the patch are being resized on the main thread, this buffer is left silent
+	if (audioComposition->beginRender())
+	{
+		mBlockAdapter.process(*audioService, output, bufferSize, nChannels);
+		audioComposition->endRender();
+	}
+	else
 	{
-		audioService->processSamplesInterleaved(nullptr, &output[i], audioService->getBufferSize(), 0, nChannels);
-		i += audioService->getBufferSize() * nChannels;
+		memset(output, 0, bufferSize * nChannels * sizeof(float));
 	}
+	audioComposition->publishGrainEvents();
+
+	if (mEnvelope != nullptr)
+		mEnvelope->process(output, bufferSize, nChannels, audioService->getSampleRate());
+
+	if (mAudioLoad != nullptr)
+		mAudioLoad->endCallback(start_time, bufferSize, audioService->getSampleRate(), mBlockAdapter.getLatency());
 }
 
 
@@ -339,13 +365,24 @@ void ofApp::createAudio()
     mCore.addService<AudioFileService>();
     mCore.addService<spatial::SpatialService>();
 
-	audioService->setBufferSize(64);
-	audioService->setSampleRate(44100);
+	mAudioProfile = gGetAudioProfile();
+	nap::Logger::info("audio profile: %s, block size: %d, sample rate: %d, device buffer: %d x %d", mAudioProfile.mName.c_str(),
+		mAudioProfile.mBufferSize, mAudioProfile.mSampleRate, mAudioProfile.mDeviceBufferSize, mAudioProfile.mDeviceBufferCount);
+
+	audioService->setBufferSize(mAudioProfile.mBufferSize);
+	audioService->setSampleRate(mAudioProfile.mSampleRate);
 	audioService->setActive(true);
     audioService->master.setValue(0.5);
 
     audioComposition = make_unique<AudioComposition>(mCore.getRoot(), ofFile("audiosettings.json").getAbsolutePath());
+}
+
 
+/**
+@brief Opens the sound device and starts pulling audio
+**/
+void ofApp::startAudio()
+{
 	// Connect to sound device
 	soundStream.printDeviceList();
 	int sound_id = gGetAppSetting<int>("SoundDeviceID", 1);
@@ -353,7 +390,14 @@ void ofApp::createAudio()
 	soundStream.setDeviceID(sound_id);
 
     int channelCount = gGetAppSetting<int>("AudioChannelCount", 2);
-	soundStream.setup(this, channelCount, 0, audioService->getSampleRate(), 256, 4);
+	mBlockAdapter.setup(audioService->getBufferSize(), channelCount);
+	mBlockAdapter.setBlockCallback([this](long long frame)
+	{
+		audioComposition->applyAttributeChanges(frame);
+		audioComposition->setGrainEventFrame(frame);
+	});
+	mAudioLoad->setDeviceBufferFrames(mAudioProfile.getDeviceBufferFrames());
+	soundStream.setup(this, channelCount, 0, audioService->getSampleRate(), mAudioProfile.mDeviceBufferSize, mAudioProfile.mDeviceBufferCount);
 
 }
 
@@ -410,6 +454,10 @@ void ofApp::createSession()
 
 	// Connect to preset changes
 	preset_comp.index.valueChangedSignal.connect(mPresetChanged);
+	preset_comp.presetRemoved.connect(mPresetRemoved);
+
+	// Add audio load measurement
+	mAudioLoad = &mSessionEntity->addComponent<nap::AudioLoadComponent>("AudioLoad");
 }
 
 
@@ -419,6 +467,7 @@ void ofApp::createSession()
 void ofApp::createAutomation()
 {
 	mAutomationEntity = &mCore.addEntity("Automation");
+	mEnvelope = &mAutomationEntity->addComponent<nap::EnvelopeComponent>("Envelope");
 	nap::AmpIntensityComponent& intensity_comp =mAutomationEntity->addComponent<nap::AmpIntensityComponent>();
 	nap::AmpScaleComponent& scale_comp = mAutomationEntity->addComponent<nap::AmpScaleComponent>();
 	nap::AmpRotateComponent& amp_rotate_comp = mAutomationEntity->addComponent<nap::AmpRotateComponent>();
@@ -426,13 +475,13 @@ void ofApp::createAutomation()
 
 	nap::GrainColorModComponent& grain_color_mod = mAutomationEntity->addComponent<nap::GrainColorModComponent>();
 	assert(audioComposition != nullptr);
-	grain_color_mod.registerGrainSignal(*audioComposition);
+	grain_color_mod.registerGrainSignal(*audioComposition, audioService->getSampleRate());
 
 	nap::GrainTraceModComponent& grain_trace_mod = mAutomationEntity->addComponent<nap::GrainTraceModComponent>();
-	grain_trace_mod.registerGrainSignal(*audioComposition);
+	grain_trace_mod.registerGrainSignal(*audioComposition, audioService->getSampleRate());
 
 	nap::GrainLFOModComponent& grain_lfo_mod = mAutomationEntity->addComponent<nap::GrainLFOModComponent>();
-	grain_lfo_mod.registerGrainSignal(*audioComposition);
+	grain_lfo_mod.registerGrainSignal(*audioComposition, audioService->getSampleRate());
 
 	// Set color component for intensity
 	nap::Entity* spline = getSpline();
@@ -472,7 +521,8 @@ void ofApp::setupGui()
 
 
 /**
-@brief Occurs when the preset index changes, loads a new preset from one that is already cached
+@brief Occurs when the preset index changes, schedules the audio settings of a preset that is already cached
+The other settings follow in the first frame after the audio settings are applied
 **/
 void ofApp::presetIndexChanged(const int& idx)
 {
@@ -480,8 +530,53 @@ void ofApp::presetIndexChanged(const int& idx)
 	assert(preset_component != nullptr);
 	mCurrentPreset = preset_component->getPreset(idx);
 	assert(mCurrentPreset != nullptr);
-	SettingSerializer serializer;
-	serializer.loadSettings(*mCurrentPreset, *mGui);
+
+	// The preset is compiled on first use and after it changed on disk
+	auto start = std::chrono::steady_clock::now();
+	preset_component->ensureLoaded(mCurrentPreset);
+	PresetSnapshot& snapshot = getSnapshot(*mCurrentPreset);
+
+	// Schedule on the audio clock, the delay is set when the switch was selected ahead of time
+	float delay = preset_component->getSwitchDelay();
+	mPendingPreset = mCurrentPreset;
+	mPendingFrame = mBlockAdapter.getFrame() + (long long)(delay * audioService->getSampleRate());
+	mPendingTimeout = start + std::chrono::milliseconds(int(delay * 1000.0f) + 250);
+	audioComposition->scheduleAttributeChanges(*snapshot.getAudioChanges(), mPendingFrame);
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	mPreparationTime = elapsed.count();
+}
+
+
+/**
+@brief Sets the gui parameters of the pending preset, the parameters of the audio attributes only show the values applied on the audio thread
+**/
+void ofApp::applyPendingPreset()
+{
+	if (mPendingPreset == nullptr)
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	bool audio_applied = audioComposition->getScheduledFrame() >= mPendingFrame;
+	if (!audio_applied && start < mPendingTimeout)
+		return;
+
+	nap::PresetComponent* preset_component = mSessionEntity->getComponent<nap::PresetComponent>();
+	assert(preset_component != nullptr);
+
+	// Audio settings were applied on the audio thread, their parameters only show the new values
+	PresetSnapshot& snapshot = getSnapshot(*mPendingPreset);
+	snapshot.apply();
+	snapshot.refreshAudioParameters();
+	mPendingPreset = nullptr;
+
+	// Report how long the switch took on this thread and how late the settings were applied
+	float sample_rate = audioService->getSampleRate();
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	preset_component->switchTime.setValue(mPreparationTime + elapsed.count());
+	if (audio_applied)
+		preset_component->audioSlack.setValue(audioComposition->getScheduleSlack() * 1000.0f / sample_rate);
+	preset_component->visualSlack.setValue(std::max<long long>(mBlockAdapter.getFrame() - mPendingFrame, 0) * 1000.0f / sample_rate);
 
 	// HACK, THESE SETTINGS ARE NOT DESERIALIZED CORRECTLY
 	// CAUSES A SET OF PARAMETERS TO NO BE IN THE RIGHT STATE
@@ -493,21 +588,69 @@ void ofApp::presetIndexChanged(const int& idx)
 }
 
 
-void ofApp::seedChanged(const int& value)
+/**
+@brief Looks up the compiled settings of the preset
+**/
+PresetSnapshot& ofApp::getSnapshot(nap::Preset& preset)
 {
-	ofSeedRandom(value);
+	PresetSnapshot& snapshot = mPresetSnapshots[&preset];
+	if (snapshot.getRevision() != preset.mRevision)
+	{
+		snapshot.compile(preset, *mGui, [this](const std::string& panel, const std::string& group, const std::string& name) -> nap::Object*
+		{
+			for (int i = 0; i < audioComposition->getPlayerCount(); i++)
+			{
+				if (panel == Gui::getAudioGuiName(i))
+					return audioComposition->findAudioAttribute(i, group, name);
+			}
+			return nullptr;
+		});
+	}
+	return snapshot;
 }
 
 
-// Called when grains change
-void ofApp::grainTriggered(lib::TimeValue& time, const lib::audio::GrainParameters& params)
+/**
+@brief Waits for the background loader, nothing is loaded on this thread
+**/
+void ofApp::prepareNextPreset()
 {
-	float mapped_v = gFit(time, 10, 1000, 0.005f, 0.45f);
-	mapped_v *= ofRandom(0.25f, 1.0f);
+	nap::PresetSwitchComponent* preset_switcher = mSessionEntity->getComponent<nap::PresetSwitchComponent>();
+	nap::Preset* next_preset = preset_switcher != nullptr ? preset_switcher->getNextPreset() : nullptr;
+	if (next_preset == nullptr || !next_preset->mLoaded)
+		return;
+	getSnapshot(*next_preset);
+}
+
 
-	OFTraceComponent* trace_comp = mSplineEntity->getComponent<OFTraceComponent>();	
-	trace_comp->mOffset.setValue(ofRandom(0.0f, 1.0f));
-	trace_comp->mLength.setValue(mapped_v);
+/**
+@brief The audio settings of a pending preset were copied when they were scheduled, the other settings are applied now
+so the switch is not left half done
+**/
+void ofApp::presetRemoved(const nap::Preset& preset)
+{
+	auto snapshot = mPresetSnapshots.find(&preset);
+	if (mPendingPreset == &preset)
+	{
+		if (snapshot != mPresetSnapshots.end())
+		{
+			snapshot->second.apply();
+			snapshot->second.refreshAudioParameters();
+		}
+		mPendingPreset = nullptr;
+	}
+
+	if (mCurrentPreset == &preset)
+		mCurrentPreset = nullptr;
+
+	if (snapshot != mPresetSnapshots.end())
+		mPresetSnapshots.erase(snapshot);
+}
+
+
+void ofApp::seedChanged(const int& value)
+{
+	ofSeedRandom(value);
 }
 
 
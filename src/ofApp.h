@@ -18,11 +18,18 @@
 #include <openFrameworks/Gui/OFControlPanel.h>
 #include <Utils/nofattributewrapper.h>
 #include <audio.h>
+#include <audioblockadapter.h>
+#include <settings.h>
+#include <presetsnapshot.h>
+#include <chrono>
+#include <unordered_map>
 
 namespace nap
 {
 	class OFService;
 	class EtherDreamService;
+	class AudioLoadComponent;
+	class EnvelopeComponent;
 	struct Preset;
 }
 
@@ -81,6 +88,7 @@ private:
 	void								flipProjectionMethod();
 	void								resetCamera();
 	void								createAudio();
+	void								startAudio();
 	void								createSpline();
 	void								createSession();
 	void								createAutomation();
@@ -98,24 +106,41 @@ private:
 
 	// Sound
 	ofSoundStream soundStream;
+	AudioProfile						mAudioProfile;					//< Selected latency profile
 	lib::audio::AudioService*			audioService = nullptr;
     lib::SchedulerService*              schedulerService = nullptr;
     std::unique_ptr<AudioComposition>	audioComposition = nullptr;
+	nap::AudioLoadComponent*			mAudioLoad = nullptr;			//< Measures callback load
+	AudioBlockAdapter					mBlockAdapter;					//< Maps device buffers on internal blocks
+	nap::EnvelopeComponent*				mEnvelope = nullptr;			//< Band envelopes of the output
 
 	// Gui + Serialization
 	Gui*								mGui;
 	nap::Preset*						mCurrentPreset = nullptr;
+	std::unordered_map<const nap::Preset*, PresetSnapshot> mPresetSnapshots;	//< Compiled settings per preset, recompiled when the revision changes
+
+	// Preset of which the audio settings are scheduled, the other settings are applied once the audio clock passed mPendingFrame
+	nap::Preset*						mPendingPreset = nullptr;
+	long long							mPendingFrame = 0;
+	std::chrono::steady_clock::time_point mPendingTimeout;						//< The settings are applied anyway when the audio clock does not run
+	float								mPreparationTime = 0.0f;				//< Milliseconds spent preparing the pending preset
 
 	void								setupGui();
 	void								presetIndexChanged(const int& idx);
+
+	// Compiled settings of the preset, compiled now when the preset changed since the last compile
+	PresetSnapshot&						getSnapshot(nap::Preset& preset);
+
+	// Compiles the preset the switcher selects next once it is loaded, so the switch itself only applies it
+	void								prepareNextPreset();
+
+	// Applies the settings of the pending preset that are not read by the audio patch, once its audio settings are applied
+	void								applyPendingPreset();
 	void								seedChanged(const int& value);
+
+	// Drops the snapshot of a preset that is about to be destroyed and every pointer to it
+	void								presetRemoved(const nap::Preset& preset);
 	NSLOT(mPresetChanged, const int&,	presetIndexChanged)
 	NSLOT(mSeedChanged, const int&,		seedChanged)
-
-	// Hook up
-	void grainTriggered(lib::TimeValue& time, const lib::audio::GrainParameters& params);
-    nap::Slot<lib::TimeValue, const lib::audio::GrainParameters&> mGrainTriggered = { [&](lib::TimeValue time, const lib::audio::GrainParameters& params)
-	{
-		grainTriggered(time, params);
-    }};
+	NSLOT(mPresetRemoved, const nap::Preset&, presetRemoved)
 };
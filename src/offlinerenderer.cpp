@@ -0,0 +1,221 @@
+#include <offlinerenderer.h>
+#include <presetcomponent.h>
+#include <settings.h>
+#include "ofMain.h"
+
+// nap
+#include <nap/coremodule.h>
+#include <nap/logger.h>
+
+// Audio
+#include <Lib/Audio/Utility/AudioFile/AudioFileService.h>
+#include <4dService/SpatialService.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <stdint.h>
+#include <string.h>
+
+using namespace lib;
+using namespace lib::audio;
+
+//////////////////////////////////////////////////////////////////////////
+
+// Writes a little endian value to the stream
+template <typename T>
+static void writeValue(std::ofstream& stream, T value)
+{
+	stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+
+// Size of the header fields the riff size includes besides the data
+static const uint32_t sWavHeaderSize = 36;
+
+
+// Writes a 32 bit float wav header, sizes are patched when the render completes
+static void writeWavHeader(std::ofstream& stream, int channelCount, int sampleRate, uint32_t dataSize)
+{
+	uint16_t block_align = channelCount * sizeof(float);
+	stream.write("RIFF", 4);
+	writeValue<uint32_t>(stream, sWavHeaderSize + dataSize);
+	stream.write("WAVE", 4);
+	stream.write("fmt ", 4);
+	writeValue<uint32_t>(stream, 16);
+	writeValue<uint16_t>(stream, 3);							// IEEE float
+	writeValue<uint16_t>(stream, channelCount);
+	writeValue<uint32_t>(stream, sampleRate);
+	writeValue<uint32_t>(stream, sampleRate * block_align);
+	writeValue<uint16_t>(stream, block_align);
+	writeValue<uint16_t>(stream, 32);
+	stream.write("data", 4);
+	writeValue<uint32_t>(stream, dataSize);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+
+/**
+@brief Renders the composition, returns false if the output could not be written
+**/
+bool OfflineRenderer::render(const Settings& settings)
+{
+	// Checked before any conversion, a negative or non finite duration has no frame count
+	if (!std::isfinite(settings.mDuration) || settings.mDuration <= 0.0f || settings.mChannelCount <= 0)
+	{
+		nap::Logger::warn("invalid render settings, duration: %.2f seconds, channels: %d", settings.mDuration, settings.mChannelCount);
+		return false;
+	}
+
+	// The wav sizes are 32 bit, longer renders are cut at the largest size the header can describe
+	const uint64_t frame_size = uint64_t(settings.mChannelCount) * sizeof(float);
+	const uint64_t max_frames = (uint64_t(UINT32_MAX) - sWavHeaderSize) / frame_size;
+	uint64_t total_frames = max_frames;
+	if (double(settings.mDuration) * settings.mSampleRate < double(max_frames))
+		total_frames = uint64_t(double(settings.mDuration) * settings.mSampleRate);
+	else
+		nap::Logger::warn("render exceeds the 4 GiB wav limit, stopping after %.2f seconds", double(max_frames) / settings.mSampleRate);
+
+	createAudio(settings);
+
+	// The parts the composition starts with are queued, apply them first so the preset is not overwritten
+	mAudioComposition->flushAttributeChanges(0);
+	if (!settings.mPreset.empty() && !applyPreset(settings.mPreset))
+		return false;
+
+	std::ofstream stream(settings.mOutputFile, std::ios::binary);
+	if (!stream)
+	{
+		nap::Logger::warn("unable to open render output file: %s", settings.mOutputFile.c_str());
+		return false;
+	}
+	writeWavHeader(stream, settings.mChannelCount, settings.mSampleRate, 0);
+
+	// Render block by block, the scheduler follows the sample clock
+	const int buffer_size = mAudioService->getBufferSize();
+	const double block_time = double(buffer_size) / double(settings.mSampleRate) * 1000.0;
+	std::vector<float> block(buffer_size * settings.mChannelCount);
+
+	nap::Logger::info("rendering %.2f seconds to: %s", double(total_frames) / settings.mSampleRate, settings.mOutputFile.c_str());
+	auto start_time = std::chrono::high_resolution_clock::now();
+
+	uint64_t rendered_frames = 0;
+	while (rendered_frames < total_frames)
+	{
+		mAudioComposition->flushAttributeChanges(rendered_frames);
+		mAudioComposition->setGrainEventFrame(rendered_frames);
+		memset(block.data(), 0, block.size() * sizeof(float));
+		mAudioService->processSamplesInterleaved(nullptr, block.data(), buffer_size, 0, settings.mChannelCount);
+		mSchedulerService->process(block_time);
+
+		uint64_t frame_count = std::min<uint64_t>(buffer_size, total_frames - rendered_frames);
+		stream.write(reinterpret_cast<const char*>(block.data()), frame_count * frame_size);
+		rendered_frames += frame_count;
+	}
+
+	auto end_time = std::chrono::high_resolution_clock::now();
+	double elapsed = std::chrono::duration<double>(end_time - start_time).count();
+
+	// Patch header sizes, the frame count was limited so the size fits
+	uint32_t data_size = uint32_t(rendered_frames * frame_size);
+	stream.seekp(0);
+	writeWavHeader(stream, settings.mChannelCount, settings.mSampleRate, data_size);
+	stream.close();
+
+	double rendered_time = double(rendered_frames) / settings.mSampleRate;
+	mRealtimeFactor = elapsed > 0.0 ? rendered_time / elapsed : 0.0;
+	nap::Logger::info("rendered %.2f seconds in %.2f seconds, realtime factor: %.2f", rendered_time, elapsed, mRealtimeFactor);
+	return true;
+}
+
+
+/**
+@brief Creates the services and the audio composition, mirrors ofApp::createAudio without opening a device
+**/
+void OfflineRenderer::createAudio(const Settings& settings)
+{
+	mAudioService = &mCore.addService<AudioService>();
+	mSchedulerService = &mCore.addService<lib::SchedulerService>();
+	mCore.addService<AudioFileService>();
+	mCore.addService<spatial::SpatialService>();
+
+	mAudioService->setBufferSize(settings.mBufferSize);
+	mAudioService->setSampleRate(settings.mSampleRate);
+	mAudioService->setActive(true);
+	mAudioService->master.setValue(0.5);
+
+	mAudioComposition = std::make_unique<AudioComposition>(mCore.getRoot(), ofFile("audiosettings.json").getAbsolutePath());
+}
+
+
+/**
+@brief Applies the audio player parts of the preset with the given name
+**/
+bool OfflineRenderer::applyPreset(const std::string& name)
+{
+	ofDirectory preset_dir("saves/" + name);
+	if (!preset_dir.exists())
+	{
+		nap::Logger::warn("unable to find preset: %s", preset_dir.getAbsolutePath().c_str());
+		return false;
+	}
+
+	nap::Preset preset(preset_dir.getAbsolutePath());
+	preset.load(gGetAppSetting<std::string>("TagFile", "spline"), gGetAppSetting<std::string>("TagPath", "Tag"));
+	for (auto& part : preset.mParts)
+	{
+		if (!part->mLoaded)
+			continue;
+
+		for (int i = 0; i < mAudioComposition->getPlayerCount(); i++)
+		{
+			std::string player_name = "audio player_" + std::to_string(i);
+			if (part->mPartName == player_name)
+				mAudioComposition->loadSettingsForPlayer(part->mSerializer, i, player_name);
+		}
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+
+bool gParseRenderSettings(int argc, char* argv[], OfflineRenderer::Settings& outSettings)
+{
+	bool render = false;
+	for (int i = 1; i < argc - 1; i++)
+	{
+		std::string arg = argv[i];
+		std::string value = argv[i + 1];
+		if (arg == "--render")
+		{
+			outSettings.mOutputFile = value;
+			render = true;
+		}
+		else if (arg == "--preset")
+			outSettings.mPreset = value;
+		else if (arg == "--duration")
+			outSettings.mDuration = std::atof(value.c_str());
+		else if (arg == "--channels")
+			outSettings.mChannelCount = std::atoi(value.c_str());
+		else
+			continue;
+		i++;
+	}
+
+	if (!render)
+		return false;
+
+	// Channel count defaults to the app setting when not specified
+	if (outSettings.mChannelCount <= 0)
+		outSettings.mChannelCount = gGetAppSetting<int>("AudioChannelCount", 2);
+
+	// Render with the block size and sample rate of the active audio profile
+	AudioProfile profile = gGetAudioProfile();
+	outSettings.mBufferSize = profile.mBufferSize;
+	outSettings.mSampleRate = profile.mSampleRate;
+	return true;
+}
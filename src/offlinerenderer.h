@@ -0,0 +1,54 @@
+#pragma once
+
+// Nap Includes
+#include <nap/core.h>
+
+// Audio Includes
+#include <Lib/Audio/Unit/AudioService.h>
+#include <Lib/Utility/Scheduler/SchedulerService.h>
+
+#include <audio.h>
+#include <memory>
+#include <string>
+
+/**
+@brief Renders an audio composition to a wav file without opening a sound stream or window
+The audio service is pulled as fast as possible, the scheduler is driven by the rendered sample clock
+**/
+class OfflineRenderer
+{
+public:
+	struct Settings
+	{
+		std::string mOutputFile;					//< Wav file to write
+		std::string mPreset;						//< Preset (directory in saves) to apply, empty for none
+		float		mDuration = 60.0f;				//< Length of the render in seconds, has to be positive
+		int			mChannelCount = 0;				//< Number of channels to render, 0 uses the AudioChannelCount app setting
+		int			mBufferSize = 64;				//< Internal audio block size
+		int			mSampleRate = 44100;			//< Sample rate of the render
+	};
+
+	OfflineRenderer() = default;
+
+	// Renders the composition described by audiosettings.json using the given settings
+	bool								render(const Settings& settings);
+
+	// Rendered audio time divided by wall clock time of the last render
+	double								getRealtimeFactor() const		{ return mRealtimeFactor; }
+
+private:
+	nap::Core							mCore;
+	lib::audio::AudioService*			mAudioService = nullptr;
+	lib::SchedulerService*				mSchedulerService = nullptr;
+	std::unique_ptr<AudioComposition>	mAudioComposition = nullptr;
+	double								mRealtimeFactor = 0.0;
+
+	// Creates services and composition
+	void								createAudio(const Settings& settings);
+
+	// Applies the audio parts of a preset
+	bool								applyPreset(const std::string& name);
+};
+
+// Parses the command line for a render request (--render <file.wav> [--preset name] [--duration sec] [--channels n])
+bool gParseRenderSettings(int argc, char* argv[], OfflineRenderer::Settings& outSettings);
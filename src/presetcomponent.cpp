@@ -3,6 +3,7 @@
 #include <Utils/nofUtils.h>
 #include <settings.h>
 #include <nap/stringutils.h>
+#include <sys/stat.h>
 
 namespace nap
 {
@@ -11,44 +12,62 @@ namespace nap
 	**/
 	PresetPart::PresetPart(const std::string& file) : mFileName(file)
 	{
-		ofFile part_file(file);
+		mPartName = ofFile(file, ofFile::Reference).getBaseName();
+	}
+
+
+	/**
+	@brief Loads the settings from file
+	**/
+	bool PresetPart::load()
+	{
+		ofFile part_file(mFileName);
 		if (!(part_file.exists()))
 		{
-			nap::Logger::warn("unable to construct preset part, file does not exist: %s", part_file.getAbsolutePath().c_str());
-			return;
+			nap::Logger::warn("unable to load preset part, file does not exist: %s", part_file.getAbsolutePath().c_str());
+			return false;
 		}
 
 		// Load the file
 		if (!mSerializer.load(mFileName))
 		{
-			nap::Logger::warn("unable to deserialize preset part from file: %s", file.c_str());
-			return;
+			nap::Logger::warn("unable to deserialize preset part from file: %s", mFileName.c_str());
+			return false;
 		}
 
-		// Store part name
-		mPartName = part_file.getBaseName();
 		mLoaded = true;
+		return true;
 	}
 
 
 	/**
-	@brief Preset constructor
+	@brief Preset constructor, only sets the name
 	**/
 	Preset::Preset(const std::string& directory)
 	{
-		ofFile preset_location(directory);
+		ofFile preset_location(directory, ofFile::Reference);
+		mPresetName = preset_location.getBaseName();
+		mFileName = preset_location.getAbsolutePath();
+	}
+
+
+	/**
+	@brief Lists and loads all parts, reads the duration
+	**/
+	void Preset::load(const std::string& tagFile, const std::string& tagPath)
+	{
+		mParts.clear();
+		mLoaded = true;
+
+		ofFile preset_location(mFileName, ofFile::Reference);
 		if (!preset_location.isDirectory())
 		{
-			nap::Logger::warn("invalid preset directory: %s", directory.c_str());
+			nap::Logger::warn("invalid preset directory: %s", mFileName.c_str());
 			return;
 		}
 
-		// Set preset name
-		mPresetName = preset_location.getBaseName();
-		mFileName = preset_location.getAbsolutePath();
-
 		// Wrap in dir
-		ofDirectory preset_dir(directory);
+		ofDirectory preset_dir(mFileName);
 		preset_dir.listDir();
 
 		for (auto& file : preset_dir.getFiles())
@@ -61,8 +80,131 @@ namespace nap
 
 			// Add as a part
 			std::unique_ptr<PresetPart> part_ptr = std::make_unique<PresetPart>(file.getAbsolutePath());
+			part_ptr->load();
 			mParts.emplace_back(std::move(part_ptr));
 		}
+
+		// populate preset part name
+		populateTags(tagFile, tagPath);
+	}
+
+
+	/**
+	@brief Drops the parts
+	**/
+	void Preset::unload()
+	{
+		mParts.clear();
+		mDuration = -1.0f;
+		mLoaded = false;
+	}
+
+
+	/**
+	@brief Stops the worker
+	**/
+	PresetLoader::~PresetLoader()
+	{
+		stop();
+	}
+
+
+	/**
+	@brief Starts the worker thread
+	**/
+	void PresetLoader::start(const std::string& tagFile, const std::string& tagPath)
+	{
+		if (mThread.joinable())
+			return;
+
+		mTagFile = tagFile;
+		mTagPath = tagPath;
+		mStopping = false;
+		mThread = std::thread(&PresetLoader::run, this);
+	}
+
+
+	/**
+	@brief Stops the worker thread, pending requests are dropped
+	**/
+	void PresetLoader::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+			mRequests.clear();
+		}
+		mCondition.notify_one();
+		if (mThread.joinable())
+			mThread.join();
+	}
+
+
+	/**
+	@brief Queues a preset to be loaded
+	**/
+	void PresetLoader::request(const std::string& directory, unsigned int revision, bool urgent)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (urgent)
+				mRequests.emplace_front(directory, revision);
+			else
+				mRequests.emplace_back(directory, revision);
+		}
+		mCondition.notify_one();
+	}
+
+
+	/**
+	@brief Drops all pending requests
+	**/
+	void PresetLoader::cancel()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRequests.clear();
+	}
+
+
+	/**
+	@brief Returns the oldest loaded preset
+	**/
+	std::unique_ptr<Preset> PresetLoader::poll(unsigned int& outRevision)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mResults.empty())
+			return nullptr;
+
+		std::unique_ptr<Preset> preset = std::move(mResults.front().first);
+		outRevision = mResults.front().second;
+		mResults.pop_front();
+		return preset;
+	}
+
+
+	/**
+	@brief Loads requested presets until stopped, the files are read without holding the lock
+	**/
+	void PresetLoader::run()
+	{
+		while (true)
+		{
+			Request request;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mCondition.wait(lock, [this] { return mStopping || !mRequests.empty(); });
+				if (mStopping)
+					return;
+				request = std::move(mRequests.front());
+				mRequests.pop_front();
+			}
+
+			std::unique_ptr<Preset> preset = std::make_unique<Preset>(request.first);
+			preset->load(mTagFile, mTagPath);
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			mResults.emplace_back(std::move(preset), request.second);
+		}
 	}
 
 
@@ -72,6 +214,107 @@ namespace nap
 	PresetComponent::PresetComponent()
 	{
 		index.valueChangedSignal.connect(mPresetChanged);
+		mTagFile = gGetAppSetting<std::string>("TagFile", "spline");
+		mTagPath = gGetAppSetting<std::string>("TagPath", "Tag");
+	}
+
+
+	/**
+	@brief Destructor, waits for the preset being loaded
+	**/
+	PresetComponent::~PresetComponent()
+	{
+		mLoader.stop();
+	}
+
+
+	/**
+	@brief Moves presets loaded in the background in to the listed presets
+	**/
+	void PresetComponent::onUpdate()
+	{
+		unsigned int revision = 0;
+		while (std::unique_ptr<Preset> loaded = mLoader.poll(revision))
+		{
+			auto it = mPresetsByPath.find(loaded->mFileName);
+			if (it == mPresetsByPath.end())
+				continue;
+
+			Preset& preset = *it->second;
+			if (preset.mLoaded || preset.mRevision != revision)
+				continue;
+
+			preset.mParts = std::move(loaded->mParts);
+			preset.mDuration = loaded->mDuration;
+			preset.mLoaded = true;
+		}
+	}
+
+
+	/**
+	@brief Loads the preset on the calling thread when the background loader did not get to it yet
+	**/
+	bool PresetComponent::ensureLoaded(Preset* preset)
+	{
+		if (preset == nullptr)
+			return false;
+
+		if (!preset->mLoaded)
+		{
+			nap::Logger::debug("loading preset on demand: %s", preset->mPresetName.c_str());
+			preset->load(mTagFile, mTagPath);
+		}
+		return true;
+	}
+
+
+	/**
+	@brief Requests the preset ahead of the others
+	**/
+	void PresetComponent::prefetch(int index)
+	{
+		if (index < 0 || index >= mPresets.size() || mPresets[index]->mLoaded)
+			return;
+		mLoader.request(mPresets[index]->mFileName, mPresets[index]->mRevision, true);
+	}
+
+
+	/**
+	@brief Stores the delay for the handlers of the index change, it is cleared once they are done
+	**/
+	void PresetComponent::selectAt(int index, float delay)
+	{
+		mSwitchDelay = delay;
+		this->index.setValue(index);
+		mSwitchDelay = 0.0f;
+	}
+
+
+	/**
+	@brief Drops the loaded parts and requests the preset again
+	**/
+	void PresetComponent::reload(Preset& preset)
+	{
+		preset.unload();
+		preset.mRevision = ++mRevision;
+		mLoader.request(preset.mFileName, preset.mRevision);
+	}
+
+
+	/**
+	@brief The directory stats do not change when files in it are overwritten, so the saved preset is reloaded explicitly
+	**/
+	void PresetComponent::presetSaved(const std::string& name)
+	{
+		for (auto& preset : mPresets)
+		{
+			if (preset->mPresetName == name)
+			{
+				reload(*preset);
+				break;
+			}
+		}
+		loadPresets();
 	}
 
 
@@ -129,9 +372,14 @@ namespace nap
 
 		// Get current preset name to match later on
 		std::string current_preset_name = mCurrentPreset != nullptr ? mCurrentPreset->mPresetName : "";
+		mLoader.start(mTagFile, mTagPath);
 
-		// Clear existing presets
+		// Keep the presets of the previous listing by directory, presets that are not found again are dropped
+		std::unordered_map<std::string, std::unique_ptr<Preset>> previous_presets;
+		for (auto& preset : mPresets)
+			previous_presets.emplace(preset->mFileName, std::move(preset));
 		mPresets.clear();
+		mPresetsByPath.clear();
 
 		// Make sure we don't have a current preset
 		mCurrentPreset = nullptr;
@@ -144,21 +392,53 @@ namespace nap
 			if(!file.isDirectory())
 				continue;
 
-			std::unique_ptr<Preset> new_preset = std::make_unique<Preset>(file.getAbsolutePath());
+			// Reuse the preset when its directory did not change
+			std::string path = file.getAbsolutePath();
+			struct stat info;
+			long long modified = 0, inode = 0;
+			if (stat(path.c_str(), &info) == 0)
+			{
+				modified = (long long)info.st_mtime;
+				inode = (long long)info.st_ino;
+			}
+
+			std::unique_ptr<Preset> new_preset;
+			auto previous = previous_presets.find(path);
+			if (previous != previous_presets.end())
+			{
+				new_preset = std::move(previous->second);
+				if (new_preset->mModified != modified || new_preset->mInode != inode)
+					reload(*new_preset);
+			}
+			else
+			{
+				new_preset = std::make_unique<Preset>(path);
+				new_preset->mRevision = ++mRevision;
+				mLoader.request(new_preset->mFileName, new_preset->mRevision);
+			}
+			new_preset->mModified = modified;
+			new_preset->mInode = inode;
+
 			if (new_preset->mPresetName == current_preset_name)
 			{
 				mCurrentPreset = new_preset.get();
 				current_preset_idx = preset_idx;
 			}
 
-			// populate preset part name
-			populateTags(*new_preset);
-
 			// Add an entry
+			mPresetsByPath[new_preset->mFileName] = new_preset.get();
 			mPresets.emplace_back(std::move(new_preset));
 			preset_idx++;
 		}
 
+		// Presets that were not found again are destroyed here, users of the previous listing are told first
+		for (auto& previous : previous_presets)
+		{
+			if (previous.second != nullptr)
+				presetRemoved.trigger(*previous.second);
+		}
+		previous_presets.clear();
+
 		// Update range
 		index.setRange(0, gMax<int>(mPresets.size() - 1, 0));
 
@@ -173,14 +453,13 @@ namespace nap
 	/**
 	@brief Populates tag values in preset
 	**/
-	void PresetComponent::populateTags(Preset& preset)
+	void Preset::populateTags(const std::string& tagFile, const std::string& tagPath)
 	{
 		// Find right part
-		std::string tag_file_name = gGetAppSetting<std::string>("TagFile", "spline");
 		const PresetPart* preset_part(nullptr);
-		for (const auto& part : preset.mParts)
+		for (const auto& part : mParts)
 		{
-			if (part->mPartName == tag_file_name)
+			if (part->mPartName == tagFile)
 			{
 				preset_part = part.get();
 				break;
@@ -190,7 +469,7 @@ namespace nap
 		// Make sure we have the part
 		if (preset_part == nullptr)
 		{
-			nap::Logger::warn(*this, "unable to fetch file: %s that contains tag information", tag_file_name.c_str());
+			nap::Logger::warn("unable to fetch file: %s that contains tag information in preset: %s", tagFile.c_str(), mPresetName.c_str());
 			return;
 		}
 
@@ -198,13 +477,12 @@ namespace nap
 		const Poco::XML::Element* current_element = preset_part->mSerializer.getPocoElement();
 		if (current_element == nullptr)
 		{
-			nap::Logger::warn(*this, "tag file has no root element!");
+			nap::Logger::warn("tag file has no root element in preset: %s", mPresetName.c_str());
 			return;
 		}
 
-		std::string tag_path = gGetAppSetting<std::string>("TagPath", "Tag");
 		std::vector<std::string> out_children;
-		gSplitString(tag_path, '/', out_children);
+		gSplitString(tagPath, '/', out_children);
 
 		// Find child
 		const Poco::XML::Element* tag_element(nullptr);
@@ -216,7 +494,7 @@ namespace nap
 		// Make sure we have one
 		if (current_element == nullptr)
 		{
-			nap::Logger::warn("Unable to find tag element with path: %s", tag_path.c_str());
+			nap::Logger::warn("Unable to find tag element with path: %s", tagPath.c_str());
 			return;
 		}
 
@@ -224,12 +502,12 @@ namespace nap
 		const Poco::XML::Element* time_element = current_element->getChildElement("PresetTime");
 		if (time_element == nullptr)
 		{
-			nap::Logger::warn(*this, "no preset time element found: %s", current_element->nodeName().c_str());
+			nap::Logger::warn("no preset time element found: %s", current_element->nodeName().c_str());
 			return;
 		}
 
 		float preset_time = std::atof(time_element->innerText().c_str());
-		preset.mDuration = preset_time;
+		mDuration = preset_time;
 	}
 
 
@@ -277,14 +555,11 @@ namespace nap
 		float diff_time = current_time - mStartTime;
 		progress.setValue(diff_time / mTargetTime);
 
-		if (diff_time < mTargetTime)
-			return;
-
-		// Time passed, select new preset
 		PresetComponent* preset_comp = mPresetComponent.get();
 		if (preset_comp == nullptr)
 		{
-			nap::Logger::warn(*this, "can't switch preset, no preset component found");
+			if (diff_time >= mTargetTime)
+				nap::Logger::warn(*this, "can't switch preset, no preset component found");
 			return;
 		}
 
@@ -292,8 +567,17 @@ namespace nap
 		if (preset_comp->getPresetCount() == 0)
 			return;
 
+		// The next preset is chosen as soon as possible, it loads while the current one plays
+		if (findNextPreset(*preset_comp) < 0)
+			chooseNextPreset(*preset_comp);
+
+		// The preset is selected ahead of time, the remaining time is passed on so the switch does not depend on the frame rate
+		float remaining_time = mTargetTime - diff_time;
+		if (remaining_time > lookahead.getValue())
+			return;
+
 		// Select a new preset when time has passed;
-		selectNewPreset(*preset_comp);
+		selectNewPreset(*preset_comp, gMax<float>(remaining_time, 0.0f));
 	}
 	
 	/**
@@ -326,7 +610,38 @@ namespace nap
 
 	// Selects a new preset
 	// Also updates the time if override is turned off (based on preset value)
-	void PresetSwitchComponent::selectNewPreset(PresetComponent& presetComp)
+	void PresetSwitchComponent::selectNewPreset(PresetComponent& presetComp, float delay)
+	{
+		// The chosen preset is invalid when it is no longer listed, changed on disk or was selected since
+		int new_preset_idx = findNextPreset(presetComp);
+		if (new_preset_idx < 0 || (new_preset_idx == presetComp.index && presetComp.getPresetCount() > 1))
+			new_preset_idx = chooseNextPreset(presetComp);
+
+		// If we're picking the preset's value, do so
+		if (fromPreset.getValue())
+		{
+			// Set new time value, the duration is read when the preset is loaded
+			Preset* new_preset = presetComp.getPreset(new_preset_idx);
+			presetComp.ensureLoaded(new_preset);
+			time.setValue(new_preset->mDuration);
+		}
+
+		// Reset, the next period starts when the switch takes effect
+		reset();
+		mStartTime += delay;
+
+		// Set new preset index
+		presetComp.selectAt(new_preset_idx, delay);
+
+		// Start loading the one after
+		chooseNextPreset(presetComp);
+	}
+
+
+	/**
+	@brief Picks a random preset other than the current one
+	**/
+	int PresetSwitchComponent::chooseNextPreset(PresetComponent& presetComp)
 	{
 		int new_preset_idx = presetComp.index;
 		if (presetComp.getPresetCount() > 1)
@@ -336,20 +651,40 @@ namespace nap
 				new_preset_idx = gMin<int>((int)ofRandom(presetComp.getPresetCount()), presetComp.getPresetCount() - 1);
 			}
 		}
+		mNextPreset = presetComp.getPreset(new_preset_idx);
+		mNextRevision = mNextPreset != nullptr ? mNextPreset->mRevision : 0;
+		presetComp.prefetch(new_preset_idx);
+		return new_preset_idx;
+	}
 
-		// If we're picking the preset's value, do so
-		if (fromPreset.getValue())
+
+	/**
+	@brief Looks the chosen preset up by address, listing the presets again can move or drop it
+	The revision is only read once the preset is known to be listed, a new preset at the same address has another revision
+	**/
+	int PresetSwitchComponent::findNextPreset(PresetComponent& presetComp) const
+	{
+		if (mNextPreset == nullptr)
+			return -1;
+
+		for (int i = 0; i < presetComp.getPresetCount(); i++)
 		{
-			// Set new time value
-			Preset* new_preset = presetComp.getPreset(new_preset_idx);
-			time.setValue(new_preset->mDuration);
+			if (presetComp.getPreset(i) == mNextPreset)
+				return mNextPreset->mRevision == mNextRevision ? i : -1;
 		}
+		return -1;
+	}
 
-		// Reset
-		reset();
 
-		// Set new preset index
-		presetComp.index.setValue(new_preset_idx);
+	/**
+	@brief Returns the chosen preset, it is validated because the presets can be listed again
+	**/
+	Preset* PresetSwitchComponent::getNextPreset()
+	{
+		PresetComponent* preset_comp = mPresetComponent.get();
+		if (preset_comp == nullptr || findNextPreset(*preset_comp) < 0)
+			return nullptr;
+		return mNextPreset;
 	}
 
 	/**
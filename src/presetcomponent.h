@@ -13,15 +13,25 @@
 #include <napofupdatecomponent.h>
 #include <nap/componentdependency.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 namespace nap
 {
 	/**
 	@brief Represents a part of a preset
+	The settings are only read from file on load
 	**/
 	struct PresetPart
 	{
 		PresetPart(const std::string& file);
 
+		// Parses the file, returns false if the file does not exist or could not be parsed
+		bool load();
+
 		ofXml mSerializer;		//< Holds all the settings
 		std::string	mPartName;	//< Holds the name of the file
 		std::string mFileName;	//< Holds the file that is loaded using the serializer
@@ -31,6 +41,7 @@ namespace nap
 
 	/**
 	@brief Represents a preset
+	Constructing a preset only sets its name, the parts and duration are available after load
 	**/
 	struct Preset
 	{
@@ -38,27 +49,96 @@ namespace nap
 
 		Preset(const std::string& directory);
 
+		// Lists and parses all parts and reads the duration from the part named @tagFile at @tagPath
+		// Does not touch anything outside of this preset, so presets can be loaded on any thread
+		void load(const std::string& tagFile, const std::string& tagPath);
+
+		// Drops the parts, they are loaded again on the next load
+		void unload();
+
 		std::string mFileName;				//< Directory holding the preset
 		std::string mPresetName;			//< Name of the preset
 		PresetParts mParts;					//< All the associated preset parts
 		float		mDuration = -1.0f;		//< Duration of the preset
+		bool		mLoaded = false;		//< If the parts and duration are loaded
+		unsigned int mRevision = 0;			//< Incremented every time the preset changes on disk, identifies background loads
+		long long	mModified = 0;			//< Modification time of the directory when it was listed
+		long long	mInode = 0;				//< File id of the directory when it was listed
+
+	private:
+		// Reads the duration tag
+		void populateTags(const std::string& tagFile, const std::string& tagPath);
+	};
+
+
+	/**
+	@brief Loads presets on a background thread
+	Requests are handled in order, loaded presets are picked up on the main thread
+	**/
+	class PresetLoader
+	{
+	public:
+		PresetLoader() = default;
+		~PresetLoader();
+
+		// Starts the worker, the tag settings are passed to Preset::load
+		void									start(const std::string& tagFile, const std::string& tagPath);
+
+		// Stops the worker, the request being loaded is finished first
+		void									stop();
+
+		// Main thread, queues loading of the preset in @directory, @revision is passed back with the result
+		// Urgent requests are handled before all others
+		void									request(const std::string& directory, unsigned int revision, bool urgent = false);
+
+		// Main thread, drops all requests that have not started
+		void									cancel();
+
+		// Main thread, returns a loaded preset or nullptr when none is ready
+		std::unique_ptr<Preset>					poll(unsigned int& outRevision);
+
+	private:
+		using Request = std::pair<std::string, unsigned int>;
+		using Result = std::pair<std::unique_ptr<Preset>, unsigned int>;
+
+		void									run();
+
+		std::thread								mThread;
+		std::mutex								mMutex;
+		std::condition_variable					mCondition;
+		std::deque<Request>						mRequests;
+		std::deque<Result>						mResults;
+		bool									mStopping = false;
+		std::string								mTagFile;
+		std::string								mTagPath;
 	};
 
 
 	/**
 	@brief Manages all the presets
 	Caches them and allows for cycling through them
+	Presets are listed by name, their parts are loaded in the background or on first use
 	Handling changes needs to be done elsewhere (app)
 	**/
-	class PresetComponent : public Component
+	class PresetComponent : public OFUpdatableComponent
 	{
-		RTTI_ENABLE_DERIVED_FROM(Component)
+		RTTI_ENABLE_DERIVED_FROM(OFUpdatableComponent)
 	public:
 		PresetComponent();
+		~PresetComponent();
+
+		// Picks up presets loaded in the background
+		virtual void							onUpdate() override;
 
 		// Current Selection
 		NumericAttribute<int>					index									{ this, "Preset", 0, 0, 1 };
 		nap::Attribute<std::string>				presetName								{ this, "Name" };
+		NumericAttribute<float>					switchTime								{ this, "SwitchTime", 0.0f, 0.0f, 100.0f };	//< Milliseconds it took to apply the last selected preset
+		NumericAttribute<float>					audioSlack								{ this, "AudioSlack", 0.0f, 0.0f, 100.0f };	//< Milliseconds the audio settings were applied after their scheduled time
+		NumericAttribute<float>					visualSlack								{ this, "VisualSlack", 0.0f, 0.0f, 100.0f };	//< Milliseconds the other settings followed after their scheduled time
+
+		// Emitted by loadPresets for every preset that is no longer found, right before it is destroyed
+		nap::Signal<const Preset&>				presetRemoved;
 
 		// Setters / Getters
 		void									setDirectory(const ofDirectory& dir)	{ mPresetDir = dir; loadPresets(); }
@@ -68,17 +148,43 @@ namespace nap
 		int										getPresetCount()						{ return mPresets.size(); }
 		Preset*									getCurrentPreset();
 
-		// Loading
+		// Loading, lists the presets and queues new and changed presets to be loaded in the background
+		// Presets whose directory did not change since the last listing are kept as they are
 		void									loadPresets();
 
+		// Reloads the preset with the given name after its files were written and lists the presets again
+		void									presetSaved(const std::string& name);
+
+		// Loads the parts of the preset now when they are not loaded yet, returns false if the preset is null
+		bool									ensureLoaded(Preset* preset);
+
+		// Moves the preset to the front of the background queue
+		void									prefetch(int index);
+
+		// Selects the preset at @index, its settings are to take effect @delay seconds from now on the audio clock
+		void									selectAt(int index, float delay);
+
+		// Delay of the selection being handled, only set while selectAt signals the index change, 0 for any other selection
+		float									getSwitchDelay() const					{ return mSwitchDelay; }
+
 	private:
 		// Preset directory
 		ofDirectory mPresetDir;
 		std::vector<std::unique_ptr<Preset>>	mPresets;
 		nap::Preset*							mCurrentPreset = nullptr;
 
-		// Populate tag
-		void									populateTags(Preset& preset);
+		// Background loading, results for an older revision of a preset are dropped
+		PresetLoader							mLoader;
+		unsigned int							mRevision = 0;
+		std::unordered_map<std::string, Preset*> mPresetsByPath;
+
+		// Delay of the pending selection
+		float									mSwitchDelay = 0.0f;
+
+		// Marks the preset as changed and queues it to be loaded
+		void									reload(Preset& preset);
+		std::string								mTagFile;
+		std::string								mTagPath;
 
 		// Preset Name
 		NSLOT(mPresetChanged, const int&, presetChanged)
@@ -105,9 +211,14 @@ namespace nap
 		NumericAttribute<float> offset =		{ this, "Deviation", 0.0f, 0.0f, 1.0f };		//< Amount of random switch offset
 		NumericAttribute<float> scale =			{ this, "Scale", 1.0f, 0.0f, 2.0f };
 		NumericAttribute<float>	progress =		{ this, "Progress", 0.0f, 0.0f, 1.0f };
+		NumericAttribute<float>	lookahead =		{ this, "Lookahead", 0.05f, 0.0f, 0.5f };		//< Seconds ahead of the switch the preset is selected, so it can be scheduled on the audio clock
 
 		void reset();
 
+		// Preset that is selected when the time has elapsed, nullptr when none is chosen yet
+		// Chosen when the timer starts so it can be loaded and prepared before it is needed
+		Preset* getNextPreset();
+
 	private:
 		ComponentDependency<PresetComponent> mPresetComponent	{ this };
 
@@ -115,6 +226,10 @@ namespace nap
 		float mTargetTime = 0.0f;
 		float mStartTime  = 0.0f;
 
+		// Preset that is selected next and its revision when it was chosen, nullptr when none is chosen
+		Preset* mNextPreset = nullptr;
+		unsigned int mNextRevision = 0;
+
 		// Reset Slot
 		NSLOT(mUpdateChanged, const bool&, updateChanged)
 		NSLOT(mSpeedChanged, const float&, speedChanged)
@@ -126,8 +241,14 @@ namespace nap
 		void offsetChanged(const float& value)	{ updateTargetTime(); }
 		void scaleChanged(const float& value)	{ updateTargetTime(); }
 
-		// Selects a new preset
-		void selectNewPreset(PresetComponent& presetComp);
+		// Selects a new preset that takes effect @delay seconds from now
+		void selectNewPreset(PresetComponent& presetComp, float delay);
+
+		// Picks the preset that is selected next and requests it ahead of the others, returns its index
+		int chooseNextPreset(PresetComponent& presetComp);
+
+		// Index of the chosen preset, -1 when none is chosen, it is no longer listed or it changed on disk since it was chosen
+		int findNextPreset(PresetComponent& presetComp) const;
 		
 		// Updates to a new target time
 		void updateTargetTime();
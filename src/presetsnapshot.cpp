@@ -0,0 +1,214 @@
+#include <presetsnapshot.h>
+#include <gui.h>
+#include <nap/logger.h>
+#include "ofxGui.h"
+
+/**
+@brief Resolves every part against the gui with the same name, the xml is not needed after this
+**/
+bool PresetSnapshot::compile(const nap::Preset& preset, const Gui& gui, const AudioAttributeResolver& audioResolver)
+{
+	mSettings.clear();
+	auto audio_changes = std::make_shared<nap::AttributeMapping>();
+	mRevision = preset.mLoaded ? preset.mRevision : 0;
+
+	bool valid = true;
+	for (const auto& part : preset.mParts)
+	{
+		if (!part->mLoaded)
+		{
+			nap::Logger::warn("unable to load preset: %s, part: %s", preset.mPresetName.c_str(), part->mPartName.c_str());
+			valid = false;
+			continue;
+		}
+
+		// Find matching gui for part
+		auto result = std::find_if(gui.getGuis().begin(), gui.getGuis().end(), [&](const auto& gui)
+		{
+			return gui->getName() == part->mPartName;
+		});
+
+		if (result == gui.getGuis().end())
+		{
+			nap::Logger::warn("unable to apply settings for preset: %s part: %s", preset.mPresetName.c_str(), part->mPartName.c_str());
+			valid = false;
+			continue;
+		}
+
+		// The root element holds the settings of the panel
+		ofAbstractParameter& parameter = (*result)->getParameter();
+		const Poco::XML::Element* root = part->mSerializer.getPocoElement();
+		if (root == nullptr || parameter.type() != typeid(ofParameterGroup).name())
+		{
+			nap::Logger::warn("unable to resolve settings for preset: %s part: %s", preset.mPresetName.c_str(), part->mPartName.c_str());
+			valid = false;
+			continue;
+		}
+		compileGroup(*root, static_cast<ofParameterGroup&>(parameter), *result, part->mPartName, audioResolver, *audio_changes);
+	}
+
+	mAudioChanges = audio_changes;
+	return valid;
+}
+
+
+/**
+@brief Applies the settings in gui order, the same order the xml was deserialized in
+Values are not compared with the parameters, the attribute behind a parameter can be changed without it
+Audio settings are skipped, they reach their attributes on the audio thread
+**/
+int PresetSnapshot::apply() const
+{
+	int count = 0;
+	for (const auto& setting : mSettings)
+	{
+		if (setting.mAudio)
+			continue;
+
+		switch (setting.mType)
+		{
+		case Type::Float:
+			setting.mParameter->cast<float>().set(setting.mFloat);
+			break;
+		case Type::Int:
+			setting.mParameter->cast<int>().set(setting.mInt);
+			break;
+		case Type::Bool:
+			setting.mParameter->cast<bool>().set(setting.mBool);
+			break;
+		case Type::String:
+			setting.mParameter->cast<std::string>().set(setting.mText);
+			break;
+		case Type::Text:
+			setting.mParameter->fromString(setting.mText);
+			break;
+		}
+		count++;
+	}
+	return count;
+}
+
+
+/**
+@brief Listeners are not notified, they would write the value back to the attribute from this thread
+**/
+void PresetSnapshot::refreshAudioParameters() const
+{
+	for (const auto& setting : mSettings)
+	{
+		if (!setting.mAudio)
+			continue;
+
+		switch (setting.mType)
+		{
+		case Type::Float:
+			setting.mParameter->cast<float>().setWithoutEventNotifications(setting.mFloat);
+			break;
+		case Type::Int:
+			setting.mParameter->cast<int>().setWithoutEventNotifications(setting.mInt);
+			break;
+		case Type::Bool:
+			setting.mParameter->cast<bool>().setWithoutEventNotifications(setting.mBool);
+			break;
+		default:
+			break;
+		}
+
+		if (setting.mWidget != nullptr)
+			setting.mWidget->setNeedsRedraw();
+	}
+}
+
+
+/**
+@brief Parameters without a matching element keep their value, same as when loading the xml
+Controls are looked up by parameter name, a missing control only means the widget is not redrawn on refresh
+**/
+void PresetSnapshot::compileGroup(const Poco::XML::Element& element, ofParameterGroup& group, ofxGuiGroup* widgets, const std::string& panel, const AudioAttributeResolver& audioResolver, nap::AttributeMapping& audioChanges)
+{
+	for (std::size_t i = 0; i < group.size(); i++)
+	{
+		ofAbstractParameter& parameter = group.get(i);
+		if (!parameter.isSerializable())
+			continue;
+
+		const Poco::XML::Element* child = element.getChildElement(parameter.getEscapedName());
+		if (child == nullptr)
+			continue;
+
+		const std::string& type = parameter.type();
+		if (type == typeid(ofParameterGroup).name())
+		{
+			ofxGuiGroup* child_widgets = widgets != nullptr ? dynamic_cast<ofxGuiGroup*>(widgets->getControl(parameter.getName())) : nullptr;
+			compileGroup(*child, static_cast<ofParameterGroup&>(parameter), child_widgets, panel, audioResolver, audioChanges);
+			continue;
+		}
+
+		Setting setting;
+		setting.mParameter = &parameter;
+		std::string text = child->innerText();
+		if (type == typeid(ofParameter<float>).name())
+		{
+			setting.mType = Type::Float;
+			setting.mFloat = ofToFloat(text);
+		}
+		else if (type == typeid(ofParameter<int>).name())
+		{
+			setting.mType = Type::Int;
+			setting.mInt = ofToInt(text);
+		}
+		else if (type == typeid(ofParameter<bool>).name())
+		{
+			setting.mType = Type::Bool;
+			setting.mBool = ofToBool(text);
+		}
+		else if (type == typeid(ofParameter<std::string>).name())
+		{
+			setting.mType = Type::String;
+			setting.mText = std::move(text);
+		}
+		else
+		{
+			setting.mText = std::move(text);
+		}
+
+		nap::Object* audio_attribute = audioResolver ? audioResolver(panel, group.getName(), parameter.getName()) : nullptr;
+		if (audio_attribute != nullptr && compileAudioSetting(setting, *audio_attribute, audioChanges))
+		{
+			setting.mAudio = true;
+			setting.mWidget = widgets != nullptr ? widgets->getControl(parameter.getName()) : nullptr;
+		}
+		mSettings.emplace_back(std::move(setting));
+	}
+}
+
+
+/**
+@brief Only plain values are compiled, other settings of the attribute are applied through the parameter
+**/
+bool PresetSnapshot::compileAudioSetting(const Setting& setting, nap::Object& attribute, nap::AttributeMapping& audioChanges)
+{
+	using MappingType = nap::AttributeMapping::Type;
+
+	const auto& type_info = attribute.getTypeInfo();
+	switch (setting.mType)
+	{
+	case Type::Float:
+		if (!type_info.isKindOf<nap::Attribute<float>>())
+			return false;
+		audioChanges.add(MappingType::Float, attribute).mFloat = setting.mFloat;
+		return true;
+	case Type::Int:
+		if (!type_info.isKindOf<nap::Attribute<int>>())
+			return false;
+		audioChanges.add(MappingType::Int, attribute).mInt = setting.mInt;
+		return true;
+	case Type::Bool:
+		if (!type_info.isKindOf<nap::Attribute<bool>>())
+			return false;
+		audioChanges.add(MappingType::Bool, attribute).mBool = setting.mBool;
+		return true;
+	default:
+		return false;
+	}
+}
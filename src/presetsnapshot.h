@@ -0,0 +1,81 @@
+#pragma once
+
+#include <presetcomponent.h>
+#include <attributemapping.h>
+#include <ofParameterGroup.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Gui;
+class ofxBaseGui;
+class ofxGuiGroup;
+
+/**
+@brief All settings of a preset, resolved against the parameters of the guis
+Compiled once after the preset is loaded, applying it sets the parameters directly without reading xml or looking up guis
+Every parameter is set, json parts write attributes without going through their parameter so a parameter can hold a stale value
+Settings of attributes that are read by the audio patch are compiled in to a mapping that is applied on the audio thread instead
+Their parameters are only refreshed, so the attributes are never written from the main thread
+**/
+class PresetSnapshot
+{
+public:
+	// Returns the attribute read by the audio patch for the parameter @name in group @group of panel @panel, nullptr for any other parameter
+	using AudioAttributeResolver = std::function<nap::Object*(const std::string& panel, const std::string& group, const std::string& name)>;
+
+	PresetSnapshot() = default;
+
+	// Resolves the settings of all loaded parts of @preset, returns false if anything could not be resolved
+	bool								compile(const nap::Preset& preset, const Gui& gui, const AudioAttributeResolver& audioResolver);
+
+	// Sets all resolved parameters that are not in the audio changes, returns the number of parameters that were set
+	int									apply() const;
+
+	// Shows the values of the audio changes in their parameters and widgets, without notifying the parameter listeners
+	// Call once the audio changes were applied, the attributes already hold these values
+	void								refreshAudioParameters() const;
+
+	// Settings of the audio attributes, never null once compiled
+	const std::shared_ptr<const nap::AttributeMapping>& getAudioChanges() const	{ return mAudioChanges; }
+
+	// Revision of the preset the snapshot was compiled from, 0 when nothing is compiled or the preset was not loaded
+	unsigned int						getRevision() const							{ return mRevision; }
+
+	// Number of resolved settings
+	int									size() const								{ return int(mSettings.size()); }
+
+private:
+	enum class Type
+	{
+		Float,
+		Int,
+		Bool,
+		String,
+		Text			//< Any other type, converted by the parameter itself
+	};
+
+	struct Setting
+	{
+		ofAbstractParameter*			mParameter = nullptr;
+		Type							mType = Type::Text;
+		float							mFloat = 0.0f;
+		int								mInt = 0;
+		bool							mBool = false;
+		std::string						mText;
+		bool							mAudio = false;				//< Applied through the audio changes
+		ofxBaseGui*						mWidget = nullptr;			//< Control of the parameter, only resolved for audio settings
+	};
+
+	// Resolves the children of @element against the parameters of @group and the controls of @widgets
+	void								compileGroup(const Poco::XML::Element& element, ofParameterGroup& group, ofxGuiGroup* widgets, const std::string& panel, const AudioAttributeResolver& audioResolver, nap::AttributeMapping& audioChanges);
+
+	// Adds the setting to the audio changes when the attribute has the type of the parameter, returns false if it was not added
+	static bool							compileAudioSetting(const Setting& setting, nap::Object& attribute, nap::AttributeMapping& audioChanges);
+
+	std::vector<Setting>				mSettings;
+	std::shared_ptr<const nap::AttributeMapping> mAudioChanges = std::make_shared<nap::AttributeMapping>();
+	unsigned int						mRevision = 0;
+};
@@ -56,3 +56,34 @@ ConfigFile& gGetAppSettings()
 }
 
 
+// Reads a profile value, values that are not positive are rejected in favour of the default
+static int getProfileValue(const AudioProfile& profile, const std::string& path, const std::string& name, int defaultValue)
+{
+	int value = gGetAppSetting<int>(path + name, defaultValue);
+	if (value > 0)
+		return value;
+
+	nap::Logger::warn("audio profile: %s, invalid %s: %d, using default: %d", profile.mName.c_str(), name.c_str(), value, defaultValue);
+	return defaultValue;
+}
+
+
+// Audio profile
+AudioProfile gGetAudioProfile()
+{
+	AudioProfile profile;
+	profile.mName = gGetAppSetting<std::string>("AudioProfile", "installation");
+
+	std::string path = "AudioProfiles:" + profile.mName + ":";
+	if (!gGetAppSettings().getSettings().tagExists("AudioProfiles:" + profile.mName))
+	{
+		nap::Logger::warn("audio profile: %s not found, using defaults", profile.mName.c_str());
+		return profile;
+	}
+
+	profile.mBufferSize = getProfileValue(profile, path, "BufferSize", profile.mBufferSize);
+	profile.mSampleRate = getProfileValue(profile, path, "SampleRate", profile.mSampleRate);
+	profile.mDeviceBufferSize = getProfileValue(profile, path, "DeviceBufferSize", profile.mDeviceBufferSize);
+	profile.mDeviceBufferCount = getProfileValue(profile, path, "DeviceBufferCount", profile.mDeviceBufferCount);
+	return profile;
+}
@@ -40,4 +40,22 @@ template <typename T>
 T gGetAppSetting(const std::string& name, const T& defaultValue)
 {
 	return gGetAppSettings().getSetting<T>(name, defaultValue);
-}
\ No newline at end of file
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// Audio latency settings, defined per profile in the app settings
+struct AudioProfile
+{
+	std::string		mName;							//< Name of the profile
+	int				mBufferSize = 64;				//< Internal audio block size
+	int				mSampleRate = 44100;			//< Sample rate of the device and engine
+	int				mDeviceBufferSize = 256;		//< Frames per device callback
+	int				mDeviceBufferCount = 4;			//< Number of device buffers
+
+	// Frames the device is configured to buffer, the driver can add more
+	int				getDeviceBufferFrames() const	{ return mDeviceBufferSize * mDeviceBufferCount; }
+};
+
+// Returns the profile selected by the AudioProfile setting, missing or non positive values use the defaults above
+AudioProfile gGetAudioProfile();
\ No newline at end of file
@@ -16,5 +16,4 @@ public:
 	// Loads / Saves all settings to disk
 	void loadSettings(const std::string& dir, const Gui& gui);
 	void saveSettings(const std::string& dir, const std::string& name, const Gui& gui);
-	void loadSettings(const nap::Preset& preset, const Gui& gui);
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+
+namespace nap
+{
+	/**
+	@brief Lock free triple buffer, hands the latest complete value from one writer thread to one reader thread
+	The writer never waits for the reader and the reader never sees a half written value
+	**/
+	template <typename T>
+	class TripleBuffer
+	{
+	public:
+		TripleBuffer() = default;
+
+		// Writer side, value to fill before publishing
+		T&							getWriteBuffer()				{ return mBuffers[mWriteIndex]; }
+
+		// Writer side, makes the write buffer the most recent value
+		void						publish();
+
+		// Reader side, returns the most recently published value
+		const T&					read();
+
+	private:
+		static const int			sDirty = 4;						//< Set on the middle index when it holds unread data
+		static const int			sIndexMask = 3;
+
+		T							mBuffers[3];
+		std::atomic<int>			mMiddle = { 1 };				//< Buffer exchanged between writer and reader
+		int							mWriteIndex = 0;				//< Owned by the writer
+		int							mReadIndex = 2;					//< Owned by the reader
+	};
+
+
+	//////////////////////////////////////////////////////////////////////////
+
+
+	template <typename T>
+	void TripleBuffer<T>::publish()
+	{
+		mWriteIndex = mMiddle.exchange(mWriteIndex | sDirty, std::memory_order_acq_rel) & sIndexMask;
+	}
+
+
+	template <typename T>
+	const T& TripleBuffer<T>::read()
+	{
+		if (mMiddle.load(std::memory_order_relaxed) & sDirty)
+			mReadIndex = mMiddle.exchange(mReadIndex, std::memory_order_acq_rel) & sIndexMask;
+		return mBuffers[mReadIndex];
+	}
+}